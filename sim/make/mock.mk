@@ -0,0 +1,22 @@
+# See LICENSE for license details.
+
+###########################
+# Mock Platform Driver    #
+###########################
+
+# Builds the driver of the current design against the in-memory mock
+# platform, which runs without an FPGA or RTL simulator. See simif_mock.cc.
+mock = $(GENERATED_DIR)/$(DESIGN)-mock
+
+$(mock): export CXXFLAGS := $(CXXFLAGS) $(common_cxx_flags) $(DRIVER_CXXOPTS)
+$(mock): export LDFLAGS := $(LDFLAGS) $(common_ld_flags)
+$(mock): $(header) $(DRIVER_CC) $(DRIVER_H) $(midas_cc) $(midas_h)
+	$(MAKE) -C $(simif_dir) driver MAIN=mock PLATFORM=mock \
+		DRIVER_NAME=$(DESIGN) \
+		GEN_FILE_BASENAME=$(BASE_FILE_NAME) \
+		GEN_DIR=$(GENERATED_DIR) \
+		OUT_DIR=$(GENERATED_DIR) \
+		DRIVER="$(DRIVER_CC)"
+
+.PHONY: mock
+mock: $(mock)
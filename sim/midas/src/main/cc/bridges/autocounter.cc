@@ -4,6 +4,7 @@
 #include <cassert>
 #include <cinttypes>
 #include <climits>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 
@@ -17,8 +18,47 @@
 
 #include <sys/mman.h>
 
+#include "core/phase_controller.h"
+
 char autocounter_t::KIND;
 
+quantile_sketch_t::quantile_sketch_t(double accuracy)
+    : gamma((1.0 + accuracy) / (1.0 - accuracy)), log_gamma(std::log(gamma)) {}
+
+void quantile_sketch_t::add(double value) {
+  count++;
+  if (value <= 0.0) {
+    zero_count++;
+    return;
+  }
+  buckets[(int)std::ceil(std::log(value) / log_gamma)]++;
+}
+
+double quantile_sketch_t::quantile(double q) const {
+  if (count == 0)
+    return 0.0;
+
+  uint64_t rank = (uint64_t)(q * (count - 1));
+  if (rank < zero_count)
+    return 0.0;
+
+  uint64_t seen = zero_count;
+  for (auto &[index, n] : buckets) {
+    seen += n;
+    if (seen > rank) {
+      // Report the midpoint of the bucket, which minimizes relative error.
+      return 2.0 * std::pow(gamma, index) / (gamma + 1.0);
+    }
+  }
+  return 2.0 * std::pow(gamma, buckets.rbegin()->first) / (gamma + 1.0);
+}
+
+void quantile_sketch_t::clear() {
+  count = 0;
+  zero_count = 0;
+  buckets.clear();
+}
+
 autocounter_t::autocounter_t(simif_t &sim,
                              AddressMap &&addr_map,
                              const AUTOCOUNTERBRIDGEMODULE_struct &mmio_addrs,
@@ -27,13 +67,21 @@ autocounter_t::autocounter_t(simif_t &sim,
                              const std::vector<Counter> &counters,
                              const ClockInfo &clock_info)
     : bridge_driver_t(sim, &KIND), mmio_addrs(mmio_addrs),
-      addr_map(std::move(addr_map)), counters(counters),
+      addr_map(std::move(addr_map)),
+      countersready(this->addr_map.r_handle("countersready")),
+      readdone(this->addr_map.w_handle("readdone")), counters(counters),
       clock_info(clock_info) {
 
   this->autocounter_filename = "AUTOCOUNTER";
   const char *autocounter_filename_in = nullptr;
   std::string readrate_arg = std::string("+autocounter-readrate=");
   std::string filename_arg = std::string("+autocounter-filename-base=");
+  // Writes only every Nth sample to the raw output (0 disables raw output)
+  std::string decimation_arg = std::string("+autocounter-raw-decimation=");
+  // Number of samples over which rolling statistics are aggregated
+  std::string aggregate_arg = std::string("+autocounter-aggregate-interval=");
+  // Smoothing factor of the exponentially-weighted moving average
+  std::string ewma_arg = std::string("+autocounter-ewma-alpha=");
 
   for (auto &arg : args) {
     if (arg.find(readrate_arg) == 0) {
@@ -65,14 +113,47 @@ See the AutoCounter documentation on Reset And Timing Considerations for discuss
       this->autocounter_filename = std::string(autocounter_filename_in) +
                                    std::to_string(autocounterno) + ".csv";
     }
+    if (arg.find(decimation_arg) == 0) {
+      raw_decimation = atol(arg.c_str() + decimation_arg.length());
+    }
+    if (arg.find(aggregate_arg) == 0) {
+      aggregate_interval = atol(arg.c_str() + aggregate_arg.length());
+    }
+    if (arg.find(ewma_arg) == 0) {
+      ewma_alpha = atof(arg.c_str() + ewma_arg.length());
+      if (ewma_alpha <= 0.0 || ewma_alpha > 1.0) {
+        throw std::runtime_error("[AutoCounter] EWMA alpha must be in (0, 1]");
+      }
+    }
   }
 
-  autocounter_file.open(this->autocounter_filename, std::ofstream::out);
+  autocounter_file.open(this->autocounter_filename, std::ios_base::out);
   if (!autocounter_file.is_open()) {
     throw std::runtime_error("Could not open output file: " +
                              this->autocounter_filename);
   }
   emit_autocounter_header();
+
+  if (aggregate_interval != 0) {
+    auto stem = autocounter_filename;
+    auto ext = stem.rfind(".csv");
+    if (ext != std::string::npos && ext + 4 == stem.length()) {
+      stem.erase(ext);
+    }
+    aggregate_filename = stem + "-aggregate.csv";
+
+    aggregate_file.open(aggregate_filename, std::ios_base::out);
+    if (!aggregate_file.is_open()) {
+      throw std::runtime_error("Could not open output file: " +
+                               aggregate_filename);
+    }
+    aggregate_file << "version," << autocounter_csv_format_version
+                   << std::endl;
+    aggregate_file << this->clock_info.as_csv_row();
+    aggregate_file << "cycle,label,samples,total,mean,min,max,ewma,p50,p90,p99"
+                   << std::endl;
+    windows.resize(counters.size());
+  }
 }
 
 autocounter_t::~autocounter_t() = default;
@@ -108,7 +189,7 @@ std::string quote_csv_element(const std::string &str) {
 
 template <typename T>
 void write_header_array_to_csv(
-    std::ofstream &os,
+    std::ostream &os,
     std::vector<autocounter_t::Counter> &counters,
     const std::string &first_column,
     const std::function<T(const autocounter_t::Counter &counter)> &f) {
@@ -155,32 +236,124 @@ void autocounter_t::emit_autocounter_header() {
 }
 
 bool autocounter_t::drain_sample() {
-  bool bridge_has_sample = read(addr_map.r_registers.at("countersready"));
+  bool bridge_has_sample = read(addr_map.r_addr(countersready));
   if (bridge_has_sample) {
     cur_cycle_base_clock += readrate_base_clock;
-    autocounter_file << cur_cycle_base_clock << ",";
+
+    if (phases && !phases->detailed(cur_cycle_base_clock)) {
+      write(addr_map.w_addr(readdone), 1);
+      skipped_samples = true;
+      return true;
+    }
+
+    std::vector<uint64_t> values(counters.size());
     for (size_t idx = 0; idx < counters.size(); idx++) {
       uint32_t addr_hi = counters[idx].event_addr_hi;
       uint32_t addr_lo = counters[idx].event_addr_lo;
 
       uint64_t counter_val = ((uint64_t)(read(addr_hi))) << 32;
       counter_val |= read(addr_lo);
-      autocounter_file << counter_val;
+      values[idx] = counter_val;
+    }
+    write(addr_map.w_addr(readdone), 1);
+
+    if (raw_decimation != 0 && sample_count % raw_decimation == 0) {
+      autocounter_file << cur_cycle_base_clock << ",";
+      for (size_t idx = 0; idx < values.size(); idx++) {
+        autocounter_file << values[idx];
+        if (idx < (values.size() - 1)) {
+          autocounter_file << ",";
+        } else {
+          autocounter_file << std::endl;
+        }
+      }
+    }
+    sample_count++;
 
-      if (idx < (counters.size() - 1)) {
-        autocounter_file << ",";
-      } else {
-        autocounter_file << std::endl;
+    if (aggregate_interval != 0 && skipped_samples) {
+      for (size_t idx = 0; idx < counters.size(); idx++) {
+        windows[idx].last_value = values[idx];
+      }
+    } else if (aggregate_interval != 0) {
+      aggregate_sample(values);
+      if (sample_count % aggregate_interval == 0) {
+        emit_aggregates();
       }
     }
-    write(addr_map.w_registers.at("readdone"), 1);
+    skipped_samples = false;
   }
   return bridge_has_sample;
 }
 
+void autocounter_t::aggregate_sample(const std::vector<uint64_t> &values) {
+  for (size_t idx = 0; idx < counters.size(); idx++) {
+    auto &counter = counters[idx];
+    auto &window = windows[idx];
+
+    // Accumulators are summarized by their rate of increase per base clock
+    // cycle, while identity counters are summarized by their sampled values.
+    double value;
+    if (counter.type == "Accumulate") {
+      uint64_t delta = values[idx] - window.last_value;
+      if (counter.accumulator_width < 64) {
+        delta &= (1ULL << counter.accumulator_width) - 1;
+      }
+      window.last_value = values[idx];
+      window.total += delta;
+      value = readrate_base_clock ? (double)delta / readrate_base_clock
+                                  : (double)delta;
+    } else {
+      value = (double)values[idx];
+    }
+
+    if (window.samples == 0) {
+      window.min = value;
+      window.max = value;
+    } else {
+      window.min = std::min(window.min, value);
+      window.max = std::max(window.max, value);
+    }
+    window.ewma = window.has_last
+                      ? ewma_alpha * value + (1.0 - ewma_alpha) * window.ewma
+                      : value;
+    window.has_last = true;
+    window.sum += value;
+    window.samples++;
+    window.sketch.add(value);
+  }
+}
+
+void autocounter_t::emit_aggregates() {
+  for (size_t idx = 0; idx < counters.size(); idx++) {
+    auto &window = windows[idx];
+    if (window.samples == 0)
+      continue;
+
+    aggregate_file << cur_cycle_base_clock << "," << counters[idx].event_label
+                   << "," << window.samples << ",";
+    if (counters[idx].type == "Accumulate") {
+      aggregate_file << window.total;
+    }
+    aggregate_file << "," << window.sum / window.samples << "," << window.min
+                   << "," << window.max << "," << window.ewma << ","
+                   << window.sketch.quantile(0.50) << ","
+                   << window.sketch.quantile(0.90) << ","
+                   << window.sketch.quantile(0.99) << std::endl;
+
+    // The moving average and the last value carry over across windows.
+    window.samples = 0;
+    window.total = 0;
+    window.sum = 0.0;
+    window.sketch.clear();
+  }
+}
+
 void autocounter_t::tick() { drain_sample(); }
 
 void autocounter_t::finish() {
   while (drain_sample())
     ;
+  if (aggregate_interval != 0) {
+    emit_aggregates();
+  }
 }
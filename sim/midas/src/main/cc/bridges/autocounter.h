@@ -4,9 +4,12 @@
 #include "core/address_map.h"
 #include "core/bridge_driver.h"
 #include "core/clock_info.h"
-#include <fstream>
+#include "core/output_file.h"
+#include <map>
 #include <vector>
 
+class phase_controller_t;
+
 // This will need to be manually incremented by descretion.
 constexpr int autocounter_csv_format_version = 1;
 
@@ -20,6 +23,30 @@ struct AUTOCOUNTERBRIDGEMODULE_struct {
   uint64_t readdone;
 };
 
+/**
+ * Streaming estimator of the quantiles of a series of non-negative samples.
+ *
+ * Samples are binned into logarithmically-spaced buckets, which bounds the
+ * relative error of a reported quantile by `accuracy`. Memory usage grows with
+ * the dynamic range of the samples instead of their number, which permits
+ * quantiles to be computed over arbitrarily long windows.
+ */
+class quantile_sketch_t {
+public:
+  explicit quantile_sketch_t(double accuracy = 0.01);
+
+  void add(double value);
+  double quantile(double q) const;
+  void clear();
+
+private:
+  double gamma;
+  double log_gamma;
+  uint64_t count = 0;
+  uint64_t zero_count = 0;
+  std::map<int, uint64_t> buckets;
+};
+
 class autocounter_t : public bridge_driver_t {
 public:
   /// The identifier for the bridge type used for casts.
@@ -48,9 +75,17 @@ public:
   void tick() override;
   void finish() override;
 
+  /**
+   * Restricts sampling to the detailed phases of the simulation. Samples
+   * taken while fast-forwarding are acknowledged without reading them.
+   */
+  void set_phases(phase_controller_t &phases) { this->phases = &phases; }
+
 private:
   const AUTOCOUNTERBRIDGEMODULE_struct mmio_addrs;
   const AddressMap addr_map;
+  const AddressMap::ReadHandle countersready;
+  const AddressMap::WriteHandle readdone;
 
   std::vector<Counter> counters;
   ClockInfo clock_info;
@@ -59,12 +94,51 @@ private:
   uint64_t readrate;
   uint64_t readrate_base_clock;
   std::string autocounter_filename;
-  std::ofstream autocounter_file;
+  output_file_t autocounter_file;
+
+  // Only every Nth sample is written to the raw output file. When set to 0,
+  // raw samples are not emitted at all.
+  uint64_t raw_decimation = 1;
+  uint64_t sample_count = 0;
+
+  // Phase schedule, if samples are only recorded in detailed phases.
+  phase_controller_t *phases = nullptr;
+  // Set if samples were skipped since the last recorded one, in which case
+  // the next sample only serves as a baseline for the rolling statistics.
+  bool skipped_samples = false;
+
+  // Rolling statistics computed in the driver over windows of samples.
+  struct CounterWindow {
+    bool has_last = false;
+    uint64_t last_value = 0;
+    uint64_t samples = 0;
+    uint64_t total = 0;
+    double sum = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double ewma = 0.0;
+    quantile_sketch_t sketch;
+  };
+
+  // The number of samples over which statistics are aggregated. Aggregation
+  // is disabled if set to 0.
+  uint64_t aggregate_interval = 0;
+  // Smoothing factor of the exponentially-weighted moving average.
+  double ewma_alpha = 0.125;
+  std::vector<CounterWindow> windows;
+  std::string aggregate_filename;
+  output_file_t aggregate_file;
 
   // Pulls a single sample from the Bridge, if available.
   // Returns true if a sample was read
   bool drain_sample();
 
+  // Folds a sample into the rolling statistics of all counters.
+  void aggregate_sample(const std::vector<uint64_t> &values);
+
+  // Writes out the statistics of the current window and resets them.
+  void emit_aggregates();
+
   // Writes event autocounter metadata to the first lines of the output csv.
   void emit_autocounter_header();
 };
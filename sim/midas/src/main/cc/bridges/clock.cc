@@ -3,6 +3,8 @@
 #include "clock.h"
 #include "core/simif.h"
 
+#include <cstdio>
+
 char clockmodule_t::KIND;
 
 clockmodule_t::clockmodule_t(simif_t &simif,
@@ -11,6 +13,25 @@ clockmodule_t::clockmodule_t(simif_t &simif,
                              const std::vector<std::string> &args)
     : widget_t(simif, &KIND), mmio_addrs(mmio_addrs) {
   assert(index == 0 && "only one clock bridge is allowed");
+
+  std::string staleness_arg = std::string("+clock-max-staleness-us=");
+  for (auto &arg : args) {
+    if (arg.find(staleness_arg) == 0) {
+      max_staleness = std::chrono::microseconds(
+          atol(arg.c_str() + staleness_arg.length()));
+    }
+    if (arg.find("+trace-record=") == 0 || arg.find("+trace-replay=") == 0) {
+      traced = true;
+    }
+  }
+
+  // Whether a cached sample is reused depends on wallclock time, which would
+  // make recorded and replayed runs issue different MMIO reads.
+  if (traced && max_staleness.count() > 0) {
+    fprintf(stderr,
+            "Ignoring +clock-max-staleness-us while recording or replaying a "
+            "host trace\n");
+  }
 }
 
 uint64_t clockmodule_t::tcycle() {
@@ -26,3 +47,20 @@ uint64_t clockmodule_t::hcycle() {
   uint32_t cycle_h = simif.read(mmio_addrs.hCycle_1);
   return (((uint64_t)cycle_h) << 32) | cycle_l;
 }
+
+void clockmodule_t::sample() {
+  uint32_t tcycle_l, tcycle_h, hcycle_l, hcycle_h;
+  mmio_batch_t batch;
+  batch.write(mmio_addrs.tCycle_latch, 1);
+  batch.read(mmio_addrs.tCycle_0, &tcycle_l);
+  batch.read(mmio_addrs.tCycle_1, &tcycle_h);
+  batch.write(mmio_addrs.hCycle_latch, 1);
+  batch.read(mmio_addrs.hCycle_0, &hcycle_l);
+  batch.read(mmio_addrs.hCycle_1, &hcycle_h);
+  simif.issue(batch);
+
+  cached.tcycle = (((uint64_t)tcycle_h) << 32) | tcycle_l;
+  cached.hcycle = (((uint64_t)hcycle_h) << 32) | hcycle_l;
+  cached.time = clock::now();
+  iteration_valid = true;
+}
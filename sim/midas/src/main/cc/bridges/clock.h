@@ -5,6 +5,7 @@
 
 #include "core/widget.h"
 
+#include <chrono>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -20,6 +21,20 @@ struct CLOCKBRIDGEMODULE_struct {
   uint64_t tCycle_latch;
 };
 
+/**
+ * Driver of the clock bridge, providing the time of the simulation.
+ *
+ * Reading a cycle counter takes a latch write and two reads. To avoid
+ * repeating these whenever a bridge needs the time, the driver caches a
+ * sample of both counters. A cached sample is reused until the driver loop
+ * starts a new iteration through `next_iteration`. With
+ * +clock-max-staleness-us=<n>, it is also reused across iterations for up to
+ * n microseconds. Samples older than a second are never reused, so that
+ * drivers which do not delimit iterations still observe progress. `tcycle`
+ * and `hcycle` always read the counters. While a host trace is recorded or
+ * replayed, samples are never reused, so that the reads of the driver do not
+ * depend on wallclock time.
+ */
 class clockmodule_t final : public widget_t {
 public:
   /// The identifier for the bridge type.
@@ -43,8 +58,59 @@ public:
    */
   uint64_t hcycle();
 
+  /**
+   * Reads both cycle counters in a single batch, refreshing the cache.
+   */
+  void sample();
+
+  /**
+   * Returns the cached target cycle, sampling the counters if it is stale.
+   */
+  uint64_t cached_tcycle() {
+    refresh();
+    return cached.tcycle;
+  }
+
+  /**
+   * Returns the cached host cycle, sampling the counters if it is stale.
+   */
+  uint64_t cached_hcycle() {
+    refresh();
+    return cached.hcycle;
+  }
+
+  /**
+   * Marks the start of an iteration of the driver loop, after which cached
+   * values are refreshed on their next use unless within the staleness bound.
+   */
+  void next_iteration() { iteration_valid = false; }
+
 private:
+  using clock = std::chrono::steady_clock;
+
+  void refresh() {
+    const auto age = clock::now() - cached.time;
+    if (traced || age > std::chrono::seconds(1) ||
+        (!iteration_valid && age > max_staleness)) {
+      sample();
+    }
+    iteration_valid = true;
+  }
+
   const CLOCKBRIDGEMODULE_struct mmio_addrs;
+
+  /// Last sample of the counters.
+  struct {
+    uint64_t tcycle = 0;
+    uint64_t hcycle = 0;
+    clock::time_point time;
+  } cached;
+  /// Set if the sample was taken or reused during the current iteration.
+  bool iteration_valid = false;
+  /// Duration for which a sample can be reused across iterations.
+  std::chrono::microseconds max_staleness{0};
+  /// Set if a host trace is recorded or replayed: every use samples anew.
+  bool traced = false;
 };
 
 #endif // __CLOCK_H
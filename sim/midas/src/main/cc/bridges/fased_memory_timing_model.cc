@@ -1,53 +1,87 @@
 // See LICENSE for license details.
 
 #include <algorithm>
+#include <cinttypes>
 #include <exception>
 #include <iostream>
 #include <stdio.h>
 
 #include "fased_memory_timing_model.h"
 
+void FpgaModel::read_counters(AddressMap::WriteHandle enable,
+                              AddressMap::WriteHandle addr,
+                              AddressMap::ReadHandle msw,
+                              AddressMap::ReadHandle lsw,
+                              uint32_t upper_word_mask,
+                              size_t count,
+                              uint64_t *values) {
+  const size_t enable_addr = addr_map.w_addr(enable);
+  const size_t addr_addr = addr_map.w_addr(addr);
+  const size_t msw_addr = addr_map.r_addr(msw);
+  const size_t lsw_addr = addr_map.r_addr(lsw);
+
+  std::vector<uint32_t> words(2 * count);
+  mmio_batch_t batch;
+  batch.write(enable_addr, 1);
+  for (size_t i = 0; i < count; i++) {
+    batch.write(addr_addr, i);
+    batch.read(msw_addr, &words[2 * i]);
+    batch.read(lsw_addr, &words[2 * i + 1]);
+  }
+  // Disable readout enable; otherwise counter updates will be gated
+  batch.write(enable_addr, 0);
+  sim->issue(batch);
+
+  for (size_t i = 0; i < count; i++) {
+    values[i] = ((uint64_t)(words[2 * i] & upper_word_mask) << 32) |
+                words[2 * i + 1];
+  }
+}
+
 void Histogram::init() {
   // Read out the initial values
-  write(enable, 1);
+  read_counters(
+      enable, addr, dataH, dataL, BIN_H_MASK, HISTOGRAM_SIZE, latency);
+  std::copy(latency, latency + HISTOGRAM_SIZE, last);
+}
+
+void Histogram::finish() {
+  uint64_t current[HISTOGRAM_SIZE];
+  read_counters(
+      enable, addr, dataH, dataL, BIN_H_MASK, HISTOGRAM_SIZE, current);
   for (size_t i = 0; i < HISTOGRAM_SIZE; i++) {
-    write(addr, i);
-    latency[i] = read64(dataH, dataL, BIN_H_MASK);
+    latency[i] = current[i] - latency[i];
   }
-  // Disable readout enable; otherwise histogram updates will be gated
-  write(enable, 0);
 }
 
-void Histogram::finish() {
-  // Read out the initial values
-  write(enable, 1);
+void Histogram::snapshot(std::ostream &os, uint64_t index) {
+  uint64_t current[HISTOGRAM_SIZE];
+  read_counters(
+      enable, addr, dataH, dataL, BIN_H_MASK, HISTOGRAM_SIZE, current);
   for (size_t i = 0; i < HISTOGRAM_SIZE; i++) {
-    write(addr, i);
-    latency[i] = read64(dataH, dataL, BIN_H_MASK) - latency[i];
+    // Bins are 36 bits wide and may wrap around between snapshots.
+    uint64_t count = (current[i] - last[i]) & ((1ULL << BIN_SIZE) - 1);
+    if (count != 0) {
+      os << index << "," << name << "," << i << "," << count << "\n";
+    }
+    last[i] = current[i];
   }
-  // Disable readout enable; otherwise histogram updates will be gated
-  write(enable, 0);
 }
 
 void AddrRangeCounter::init() {
   nranges = read("numRanges");
   range_bytes = new uint64_t[nranges];
-
-  write(enable, 1);
-  for (size_t i = 0; i < nranges; i++) {
-    write(addr, i);
-    range_bytes[i] = read64(dataH, dataL, RANGE_H_MASK);
-  }
-  write(enable, 0);
+  read_counters(
+      enable, addr, dataH, dataL, RANGE_H_MASK, nranges, range_bytes);
 }
 
 void AddrRangeCounter::finish() {
-  write(enable, 1);
-  for (size_t i = 0; i < nranges; i++) {
-    write(addr, i);
-    range_bytes[i] = read64(dataH, dataL, RANGE_H_MASK);
-  }
-  write(enable, 0);
+  read_counters(
+      enable, addr, dataH, dataL, RANGE_H_MASK, nranges, range_bytes);
+}
+
+void AddrRangeCounter::sample(uint64_t *values) {
+  read_counters(enable, addr, dataH, dataL, RANGE_H_MASK, nranges, values);
 }
 
 char FASEDMemoryTimingModel::KIND;
@@ -60,41 +94,43 @@ FASEDMemoryTimingModel::FASEDMemoryTimingModel(
     const std::string &stats_file_name,
     size_t mem_size)
     : bridge_driver_t(simif, &KIND), addr_map(std::move(addr_map)),
-      mem_size(mem_size) {
+      suffix("_" + std::to_string(modelno)), mem_size(mem_size) {
 
-  std::string suffix = "_" + std::to_string(modelno);
   for (auto &arg : args) {
-    // Find arguments: +mm_{name}{index}={value}
-    if (arg.find("+mm_") != 0 || arg.find(suffix) == std::string::npos) {
+    std::string key, value;
+    if (!parse_arg(arg, key, value)) {
       continue;
     }
 
-    auto sub_arg = arg.substr(4);
-    size_t delimit_idx = sub_arg.find("=");
-    size_t suffix_idx = sub_arg.find(suffix);
-    std::string key = sub_arg.substr(0, suffix_idx).c_str();
-
     // This is the only nullary plusarg supported by fased
     if (key == std::string("useHardwareDefaultRuntimeSettings")) {
       useHardwareDefaults = true;
       continue;
     }
 
+    // Driver-side settings, not backed by registers of the bridge module
+    if (key == std::string("binaryProfile")) {
+      binary_profile = true;
+      continue;
+    }
+    if (key == std::string("profileRangeCounters")) {
+      profile_range_counters = true;
+      continue;
+    }
+    if (key == std::string("histogramSnapshotPeriod")) {
+      histogram_snapshot_period = std::stoull(value);
+      continue;
+    }
+
     // All other plusargs are key-value pairs that will be written to the
     // bridge module
-    if (suffix_idx == std::string::npos) {
+    if (value.empty()) {
       throw std::runtime_error("[FASED] unknown nullary plusarg: " + key);
     }
     if (!addr_map.w_reg_exists(key)) {
       throw std::runtime_error("[FASED] unknown register: " + key);
     }
-    int value = std::stoi(sub_arg.substr(delimit_idx + 1).c_str());
-    user_configuration[key] = value;
-  }
-
-  stats_file.open(stats_file_name, std::ofstream::out);
-  if (!stats_file.is_open()) {
-    throw std::runtime_error("Could not open output file: " + stats_file_name);
+    user_configuration[key] = std::stoi(value);
   }
 
   for (const auto &pair : addr_map.r_registers) {
@@ -109,11 +145,43 @@ FASEDMemoryTimingModel::FASEDMemoryTimingModel(
       }
       if (!exclude) {
         profile_reg_addrs.push_back(pair.second);
-        stats_file << pair.first << ",";
+        profile_reg_names.push_back(pair.first);
       }
     }
   }
-  stats_file << std::endl;
+
+  profile_row.resize(profile_reg_addrs.size());
+  for (size_t i = 0; i < profile_reg_addrs.size(); i++) {
+    profile_batch.read(profile_reg_addrs[i], &profile_row[i]);
+  }
+
+  if (binary_profile) {
+    binary_profile_file_name = stats_file_name;
+    auto ext = binary_profile_file_name.rfind(".csv");
+    if (ext != std::string::npos &&
+        ext + 4 == binary_profile_file_name.length()) {
+      binary_profile_file_name.erase(ext);
+    }
+    binary_profile_file_name += ".bin";
+
+    binary_profile_file.open(binary_profile_file_name,
+                             std::ios_base::out | std::ios_base::binary);
+    if (!binary_profile_file.is_open()) {
+      throw std::runtime_error("Could not open output file: " +
+                               binary_profile_file_name);
+    }
+    profile_columns.resize(profile_reg_addrs.size());
+  } else {
+    stats_file.open(stats_file_name, std::ios_base::out);
+    if (!stats_file.is_open()) {
+      throw std::runtime_error("Could not open output file: " +
+                               stats_file_name);
+    }
+    for (auto &name : profile_reg_names) {
+      stats_file << name << ",";
+    }
+    stats_file << std::endl;
+  }
 
   if (addr_map.w_reg_exists("hostReadLatencyHist_enable")) {
     histograms.emplace_back(&simif, addr_map, "hostReadLatency");
@@ -130,13 +198,189 @@ FASEDMemoryTimingModel::FASEDMemoryTimingModel(
     rangectrs.emplace_back(&simif, addr_map, "read");
     rangectrs.emplace_back(&simif, addr_map, "write");
   }
+
+  if (histogram_snapshot_period != 0 && !histograms.empty()) {
+    auto snapshot_file_name = stats_file_name;
+    auto ext = snapshot_file_name.rfind(".csv");
+    if (ext != std::string::npos && ext + 4 == snapshot_file_name.length()) {
+      snapshot_file_name.erase(ext);
+    }
+    snapshot_file_name += "-histograms.csv";
+
+    histogram_snapshot_file.open(snapshot_file_name, std::ios_base::out);
+    if (!histogram_snapshot_file.is_open()) {
+      throw std::runtime_error("Could not open output file: " +
+                               snapshot_file_name);
+    }
+    histogram_snapshot_file << "profile,histogram,bin,count" << std::endl;
+    fprintf(stderr,
+            "[FASED] Warning: latency histograms stop counting while they are "
+            "snapshotted. The duration of each gap is recorded as a "
+            "readout_gap row of %s\n",
+            snapshot_file_name.c_str());
+  }
+}
+
+bool FASEDMemoryTimingModel::parse_arg(const std::string &arg,
+                                       std::string &key,
+                                       std::string &value) const {
+  // Find arguments: +mm_{name}{index}={value}. The index must end the name:
+  // the plusargs of model 10 also contain the suffix of model 1.
+  if (arg.find("+mm_") != 0) {
+    return false;
+  }
+
+  const size_t delimit_idx = arg.find("=");
+  const std::string name = arg.substr(4, delimit_idx - 4);
+  if (name.size() <= suffix.size() ||
+      name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+    return false;
+  }
+
+  key = name.substr(0, name.size() - suffix.size());
+  value = delimit_idx == std::string::npos ? "" : arg.substr(delimit_idx + 1);
+  return true;
+}
+
+void FASEDMemoryTimingModel::reprogram(const std::vector<std::string> &args) {
+  for (auto &arg : args) {
+    std::string key, value;
+    if (!parse_arg(arg, key, value)) {
+      continue;
+    }
+    if (value.empty() || !addr_map.w_reg_exists(key)) {
+      throw std::runtime_error("[FASED] cannot reprogram register: " + arg);
+    }
+    user_configuration[key] = std::stoi(value);
+    write(addr_map.w_addr(key), user_configuration[key]);
+  }
+}
+
+const std::vector<uint32_t> &FASEDMemoryTimingModel::read_profile_registers() {
+  simif.issue(profile_batch);
+  return profile_row;
 }
 
 void FASEDMemoryTimingModel::profile() {
-  for (auto addr : profile_reg_addrs) {
-    stats_file << read(addr) << ",";
+  simif.issue(profile_batch);
+  if (binary_profile) {
+    append_profile_sample();
+  } else {
+    for (auto value : profile_row) {
+      stats_file << value << ",";
+    }
+    stats_file << std::endl;
+  }
+
+  ++profile_count;
+  if (histogram_snapshot_file.is_open() &&
+      profile_count % histogram_snapshot_period == 0) {
+    snapshot_histograms();
+  }
+}
+
+void FASEDMemoryTimingModel::snapshot_histograms() {
+  // Histograms stop counting while they are read out, one serialized MMIO
+  // at a time. Measure the gap, in host cycles if the model counts them, so
+  // that the missing samples are accounted for.
+  const bool has_hcycle = addr_map.r_reg_exists("hostCycle");
+  const size_t hcycle_addr = has_hcycle ? addr_map.r_addr("hostCycle") : 0;
+  const uint32_t start_hcycle = has_hcycle ? read(hcycle_addr) : 0;
+  const midas_time_t start_time = timestamp();
+
+  for (auto &hist : histograms) {
+    hist.snapshot(histogram_snapshot_file, profile_count);
+  }
+
+  uint64_t gap;
+  if (has_hcycle) {
+    gap = (uint32_t)(read(hcycle_addr) - start_hcycle);
+    histogram_snapshot_file << profile_count << ",readout_gap_host_cycles,0,";
+  } else {
+    gap = diff_secs(timestamp(), start_time) * 1e6;
+    histogram_snapshot_file << profile_count << ",readout_gap_us,0,";
+  }
+  histogram_snapshot_file << gap << "\n";
+  histogram_snapshot_gap += gap;
+  ++histogram_snapshot_count;
+}
+
+void FASEDMemoryTimingModel::append_profile_sample() {
+  profile_times.push_back(timestamp());
+  for (size_t i = 0; i < profile_row.size(); i++) {
+    profile_columns[i].push_back(profile_row[i]);
+  }
+
+  if (profile_range_counters) {
+    std::vector<uint64_t> values;
+    size_t column = 0;
+    for (auto &rctr : rangectrs) {
+      values.resize(rctr.nranges);
+      rctr.sample(values.data());
+      for (auto value : values) {
+        range_columns[column++].push_back(value);
+      }
+    }
+  }
+
+  if (profile_times.size() == profile_block_rows) {
+    write_profile_block();
+  }
+}
+
+// The binary profile starts with a header describing the columns:
+//   "FASEDPRF", u32 version, u32 column count,
+//   for each column: u32 name length, name, u8 value width in bytes.
+// It is followed by blocks of samples:
+//   u32 row count, then the values of each column in turn.
+// All integers are in the byte order of the host.
+void FASEDMemoryTimingModel::write_profile_header() {
+  auto &os = binary_profile_file;
+  auto write_column = [&os](const std::string &name, uint8_t width) {
+    uint32_t length = name.length();
+    os.write((const char *)&length, sizeof(length));
+    os.write(name.data(), length);
+    os.write((const char *)&width, sizeof(width));
+  };
+
+  const uint32_t version = 1;
+  const uint32_t ncolumns = 1 + profile_columns.size() + range_columns.size();
+  os.write("FASEDPRF", 8);
+  os.write((const char *)&version, sizeof(version));
+  os.write((const char *)&ncolumns, sizeof(ncolumns));
+
+  write_column("timestamp_us", sizeof(midas_time_t));
+  for (auto &name : profile_reg_names) {
+    write_column(name, sizeof(uint32_t));
+  }
+  if (profile_range_counters) {
+    for (auto &rctr : rangectrs) {
+      for (size_t i = 0; i < rctr.nranges; i++) {
+        write_column(rctr.name + "Ranges_" + std::to_string(i),
+                     sizeof(uint64_t));
+      }
+    }
+  }
+}
+
+void FASEDMemoryTimingModel::write_profile_block() {
+  const uint32_t rows = profile_times.size();
+  if (rows == 0) {
+    return;
+  }
+
+  auto &os = binary_profile_file;
+  os.write((const char *)&rows, sizeof(rows));
+  os.write((const char *)profile_times.data(), rows * sizeof(midas_time_t));
+  profile_times.clear();
+  for (auto &column : profile_columns) {
+    os.write((const char *)column.data(), rows * sizeof(uint32_t));
+    column.clear();
+  }
+  for (auto &column : range_columns) {
+    os.write((const char *)column.data(), rows * sizeof(uint64_t));
+    column.clear();
   }
-  stats_file << std::endl;
 }
 
 void FASEDMemoryTimingModel::init() {
@@ -190,9 +434,38 @@ void FASEDMemoryTimingModel::init() {
   for (auto &rctr : rangectrs) {
     rctr.init();
   }
+
+  // The number of address ranges is only known once the counters are
+  // initialized, so the layout of the binary profile is fixed here.
+  if (binary_profile) {
+    if (profile_range_counters) {
+      size_t ncolumns = 0;
+      for (auto &rctr : rangectrs) {
+        ncolumns += rctr.nranges;
+      }
+      range_columns.resize(ncolumns);
+    }
+    write_profile_header();
+  }
 }
 
 void FASEDMemoryTimingModel::finish() {
+  if (binary_profile) {
+    write_profile_block();
+  }
+
+  // Emit the samples accumulated since the last periodic snapshot.
+  if (histogram_snapshot_file.is_open()) {
+    snapshot_histograms();
+    fprintf(stderr,
+            "[FASED] %" PRIu64 " histogram snapshots stopped latency "
+            "histograms for %" PRIu64 " %s: samples of these windows are "
+            "missing from the snapshots and from latency_histogram.csv\n",
+            histogram_snapshot_count,
+            histogram_snapshot_gap,
+            addr_map.r_reg_exists("hostCycle") ? "host cycles" : "us");
+  }
+
   for (auto &hist : histograms) {
     hist.finish();
   }
@@ -200,8 +473,8 @@ void FASEDMemoryTimingModel::finish() {
     rctr.finish();
   }
 
-  std::ofstream histogram_file;
-  histogram_file.open("latency_histogram.csv", std::ofstream::out);
+  output_file_t histogram_file;
+  histogram_file.open("latency_histogram.csv", std::ios_base::out);
   if (!histogram_file.is_open()) {
     throw std::runtime_error("Could not open histogram output file");
   }
@@ -222,9 +495,9 @@ void FASEDMemoryTimingModel::finish() {
 
   if (!rangectrs.empty()) {
     size_t nranges = rangectrs[0].nranges;
-    std::ofstream rangectr_file;
+    output_file_t rangectr_file;
 
-    rangectr_file.open("range_counters.csv", std::ofstream::out);
+    rangectr_file.open("range_counters.csv", std::ios_base::out);
     if (!rangectr_file.is_open()) {
       throw std::runtime_error("Could not open range counter file");
     }
@@ -5,8 +5,9 @@
 
 #include "core/address_map.h"
 #include "core/bridge_driver.h"
+#include "core/output_file.h"
+#include "core/timing.h"
 
-#include <fstream>
 #include <set>
 #include <unordered_map>
 
@@ -56,6 +57,20 @@ protected:
     uint64_t data = ((uint64_t)(read(msw) & upper_word_mask)) << 32;
     return data | read(lsw);
   }
+
+  /**
+   * Reads out all entries of a counter table through its readout registers.
+   *
+   * The table stops counting while its readout is enabled, which lasts for
+   * three MMIO round trips per entry: events of that window are lost.
+   */
+  void read_counters(AddressMap::WriteHandle enable,
+                     AddressMap::WriteHandle addr,
+                     AddressMap::ReadHandle msw,
+                     AddressMap::ReadHandle lsw,
+                     uint32_t upper_word_mask,
+                     size_t count,
+                     uint64_t *values);
 };
 
 // MICRO HACKS.
@@ -76,15 +91,20 @@ public:
   void profile() override {}
   void finish() override;
 
+  /**
+   * Reads the current byte counts of all ranges into `values`.
+   */
+  void sample(uint64_t *values);
+
   std::string name;
   uint64_t *range_bytes;
   size_t nranges;
 
 private:
-  std::string enable = name + "Ranges_enable";
-  std::string dataH = name + "Ranges_dataH";
-  std::string dataL = name + "Ranges_dataL";
-  std::string addr = name + "Ranges_addr";
+  AddressMap::WriteHandle enable = addr_map.w_handle(name + "Ranges_enable");
+  AddressMap::ReadHandle dataH = addr_map.r_handle(name + "Ranges_dataH");
+  AddressMap::ReadHandle dataL = addr_map.r_handle(name + "Ranges_dataL");
+  AddressMap::WriteHandle addr = addr_map.w_handle(name + "Ranges_addr");
 };
 
 class Histogram final : public FpgaModel {
@@ -95,14 +115,24 @@ public:
   void init() override;
   void profile() override {}
   void finish() override;
+
+  /**
+   * Writes the non-zero bins accumulated since the previous snapshot as
+   * `index,name,bin,count` rows.
+   */
+  void snapshot(std::ostream &os, uint64_t index);
+
   std::string name;
   uint64_t latency[HISTOGRAM_SIZE];
 
 private:
-  std::string enable = name + "Hist_enable";
-  std::string dataH = name + "Hist_dataH";
-  std::string dataL = name + "Hist_dataL";
-  std::string addr = name + "Hist_addr";
+  // Bin values read out by the last snapshot.
+  uint64_t last[HISTOGRAM_SIZE];
+
+  AddressMap::WriteHandle enable = addr_map.w_handle(name + "Hist_enable");
+  AddressMap::ReadHandle dataH = addr_map.r_handle(name + "Hist_dataH");
+  AddressMap::ReadHandle dataL = addr_map.r_handle(name + "Hist_dataL");
+  AddressMap::WriteHandle addr = addr_map.w_handle(name + "Hist_addr");
 };
 
 struct FASEDMEMORYTIMINGMODEL_struct {};
@@ -129,10 +159,36 @@ public:
   void finish() override;
   void profile();
 
+  /**
+   * Overrides the timing parameters of the model while it is idle.
+   *
+   * Parameters are given as +mm_<register>_<idx>=<value> plusargs, of which
+   * only those addressed to this model are applied.
+   */
+  void reprogram(const std::vector<std::string> &args);
+
+  /**
+   * Reads the instrumentation registers sampled by `profile`.
+   */
+  const std::vector<uint32_t> &read_profile_registers();
+  const std::vector<std::string> &get_profile_register_names() const {
+    return profile_reg_names;
+  }
+
   const AddressMap &get_addr_map() const { return addr_map; }
 
 private:
   const AddressMap addr_map;
+  /// Suffix of the plusargs addressed to this model.
+  const std::string suffix;
+
+  /**
+   * Splits a +mm_<key>_<idx>=<value> plusarg addressed to this model into its
+   * key and value. Returns false if the plusarg targets some other model.
+   */
+  bool parse_arg(const std::string &arg,
+                 std::string &key,
+                 std::string &value) const;
 
   /**
    * User-provided configuration options.
@@ -140,7 +196,11 @@ private:
   std::unordered_map<std::string, uint32_t> user_configuration;
 
   std::vector<uint32_t> profile_reg_addrs;
-  std::ofstream stats_file;
+  std::vector<std::string> profile_reg_names;
+  // Values of the profiled registers, filled in by profile_batch.
+  std::vector<uint32_t> profile_row;
+  mmio_batch_t profile_batch;
+  output_file_t stats_file;
   std::vector<Histogram> histograms;
   std::vector<AddrRangeCounter> rangectrs;
   std::set<std::string> configuration_exclusion{"Hist_dataL",
@@ -176,6 +236,42 @@ private:
   // instead use the hardware reset values (which map to the values emitted in
   // the runtime.conf) and print those values to the log instead.
   bool useHardwareDefaults = false;
+
+  // Number of calls to profile so far.
+  uint64_t profile_count = 0;
+  // Latency histograms are snapshotted every N calls to profile, set with
+  // the plus arg +mm_histogramSnapshotPeriod_<idx>=N. Disabled if set to 0.
+  uint64_t histogram_snapshot_period = 0;
+  output_file_t histogram_snapshot_file;
+  // Number of snapshots taken and total duration over which they stopped the
+  // histograms, in host cycles (or microseconds without a host cycle count).
+  uint64_t histogram_snapshot_count = 0;
+  uint64_t histogram_snapshot_gap = 0;
+
+  /**
+   * Appends the bins accumulated since the last snapshot to the snapshot
+   * file, followed by the duration of the readout, during which the
+   * histograms did not count.
+   */
+  void snapshot_histograms();
+
+  // With +mm_binaryProfile_<idx>, profile samples are accumulated in memory,
+  // one column per value, and written out in binary blocks instead of CSV
+  // rows. Address range counters are sampled along with the registers if
+  // +mm_profileRangeCounters_<idx> is also set.
+  bool binary_profile = false;
+  bool profile_range_counters = false;
+  std::string binary_profile_file_name;
+  output_file_t binary_profile_file;
+  std::vector<midas_time_t> profile_times;
+  std::vector<std::vector<uint32_t>> profile_columns;
+  std::vector<std::vector<uint64_t>> range_columns;
+  // Number of samples buffered before a block is written out.
+  static constexpr size_t profile_block_rows = 4096;
+
+  void append_profile_sample();
+  void write_profile_header();
+  void write_profile_block();
 };
 
 #endif // __FASED_MEMORY_TIMING_MODEL_H
@@ -36,7 +36,10 @@ heartbeat_t::heartbeat_t(simif_t &sim,
 void heartbeat_t::tick() {
   if (trip_count == polling_interval) {
     trip_count = 0;
-    uint64_t current_cycle = clock.tcycle();
+    // Sample the counters anew: a cached value could be as old as the period
+    // of the heartbeat and report a deadlock on a target which advances.
+    clock.sample();
+    uint64_t current_cycle = clock.cached_tcycle();
     if (!ignore_heartbeat) {
       has_timed_out |= current_cycle == last_cycle;
     }
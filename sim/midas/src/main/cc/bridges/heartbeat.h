@@ -2,8 +2,7 @@
 #define __HEARTBEAT_H
 
 #include "core/bridge_driver.h"
-
-#include <fstream>
+#include "core/output_file.h"
 
 class clockmodule_t;
 
@@ -31,7 +30,7 @@ public:
 
 private:
   clockmodule_t &clock;
-  std::ofstream log;
+  output_file_t log;
   time_t start_time;
 
   bool has_timed_out = false;
@@ -2,12 +2,20 @@
 
 #include "loadmem.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 
+#include "core/memory_image.h"
 #include "core/simif.h"
 
 char loadmem_t::KIND;
 
+/// Maximum number of beats written by a single request to the widget.
+static constexpr size_t max_request_beats = 4096;
+
+/// Number of bytes of zeros written to DRAM at once.
+static constexpr size_t zero_chunk_bytes = 1 << 20;
+
 loadmem_t::loadmem_t(simif_t &simif,
                      const LOADMEMWIDGET_struct &mmio_addrs,
                      unsigned index,
@@ -15,59 +23,58 @@ loadmem_t::loadmem_t(simif_t &simif,
                      const AXI4Config &mem_conf,
                      unsigned mem_data_chunk)
     : widget_t(simif, &KIND), mmio_addrs(mmio_addrs), mem_conf(mem_conf),
-      mem_data_chunk(mem_data_chunk) {
+      mem_data_chunk(mem_data_chunk),
+      image_options(memory_image_t::parse_args(args)) {
   assert(index == 0 && "only one loadmem widget is allowed");
 }
 
 void loadmem_t::load_mem_from_file(const std::string &filename) {
+  write_mem_image(*read_mem_image(filename));
+}
+
+std::shared_ptr<const memory_image_t>
+loadmem_t::read_mem_image(const std::string &filename) const {
   fprintf(stdout, "[loadmem] start loading file: %s\n", filename.c_str());
-  std::ifstream file(filename.c_str());
-  if (!file) {
-    fprintf(stderr, "[loadmem] cannot open %s\n", filename.c_str());
-    exit(EXIT_FAILURE);
-  }
+  return memory_image_t::load_shared(
+      filename, image_options, mem_data_chunk * sizeof(uint32_t));
+}
 
-  const size_t chunk = mem_conf.data_bits / 4;
-  fprintf(stdout, "[loadmem] start loading, chunk = %ld\n", chunk);
-
-  size_t addr = 0;
-  std::string line;
-  mpz_t data;
-  mpz_init(data);
-  while (std::getline(file, line)) {
-    assert(line.length() % chunk == 0);
-    for (int j = line.length() - chunk; j >= 0; j -= chunk) {
-      mpz_set_str(data, line.substr(j, chunk).c_str(), 16);
-      write_mem(addr, data);
-      addr += chunk / 2;
+void loadmem_t::write_mem_image(const memory_image_t &image) {
+  for (auto &segment : image.segments) {
+    fprintf(stdout,
+            "[loadmem] segment at 0x%llx: %zu bytes, %llu zero bytes\n",
+            (unsigned long long)segment.addr,
+            segment.data.size(),
+            (unsigned long long)segment.zero_bytes);
+    write_mem_bytes(segment.addr, segment.data.data(), segment.data.size());
+    // Freshly zeroed out DRAM needs no further zeroing.
+    if (!dram_zeroed) {
+      zero_mem(segment.addr + segment.data.size(), segment.zero_bytes);
     }
   }
-  mpz_clear(data);
-  file.close();
   fprintf(stdout, "[loadmem] done\n");
 }
 
-void loadmem_t::read_mem(size_t addr, mpz_t &value) {
-  // NB: mpz_t variables may not export <size> <uint32_t> beats, if initialized
-  // with an array of zeros.
+loadmem_t::beat_t loadmem_t::read_mem(size_t addr) {
+  assert(mem_data_chunk * 32 <= beat_t::capacity);
   simif.write(mmio_addrs.R_ADDRESS_H, addr >> 32);
   simif.write(mmio_addrs.R_ADDRESS_L, addr & ((1ULL << 32) - 1));
   uint32_t data[mem_data_chunk];
   for (size_t i = 0; i < mem_data_chunk; i++) {
     data[i] = simif.read(mmio_addrs.R_DATA);
   }
-  mpz_import(value, mem_data_chunk, -1, sizeof(uint32_t), 0, 0, data);
+  return beat_t::from_chunks(data, mem_data_chunk);
 }
 
-void loadmem_t::write_mem(size_t addr, mpz_t &value) {
+void loadmem_t::write_mem(size_t addr, const beat_t &value) {
+  assert(mem_data_chunk * 32 <= beat_t::capacity);
   simif.write(mmio_addrs.W_ADDRESS_H, addr >> 32);
   simif.write(mmio_addrs.W_ADDRESS_L, addr & ((1ULL << 32) - 1));
   simif.write(mmio_addrs.W_LENGTH, 1);
-  size_t size;
-  uint32_t *data =
-      (uint32_t *)mpz_export(nullptr, &size, -1, sizeof(uint32_t), 0, 0, value);
+  uint32_t data[mem_data_chunk];
+  value.to_chunks(data, mem_data_chunk);
   for (size_t i = 0; i < mem_data_chunk; i++) {
-    simif.write(mmio_addrs.W_DATA, i < size ? data[i] : 0);
+    simif.write(mmio_addrs.W_DATA, data[i]);
   }
 }
 
@@ -89,8 +96,129 @@ void loadmem_t::write_mem_chunk(size_t addr, mpz_t &value, size_t bytes) {
   }
 }
 
+void loadmem_t::write_mem_bytes(size_t addr,
+                                const uint8_t *data,
+                                size_t size) {
+  if (size == 0 || simif.write_dram(addr, data, size)) {
+    return;
+  }
+
+  const size_t beat_bytes = mem_data_chunk * sizeof(uint32_t);
+  assert(addr % beat_bytes == 0 && "unaligned DRAM write");
+
+  auto skip_beat = [&](size_t offset) {
+    if (!dram_zeroed) {
+      return false;
+    }
+    const size_t n = std::min(beat_bytes, size - offset);
+    return std::all_of(data + offset, data + offset + n, [](uint8_t b) {
+      return b == 0;
+    });
+  };
+
+  // Each request sets up the address and length of a run of beats once, then
+  // streams in the data of all beats. Requests are issued as MMIO batches.
+  mmio_batch_t batch;
+  size_t offset = 0;
+  while (offset < size) {
+    if (skip_beat(offset)) {
+      offset += beat_bytes;
+      continue;
+    }
+
+    const size_t start = offset;
+    size_t beats = 0;
+    while (offset < size && beats < max_request_beats && !skip_beat(offset)) {
+      offset += beat_bytes;
+      beats++;
+    }
+
+    const size_t beat_addr = addr + start;
+    batch.clear();
+    batch.write(mmio_addrs.W_ADDRESS_H, beat_addr >> 32);
+    batch.write(mmio_addrs.W_ADDRESS_L, beat_addr & ((1ULL << 32) - 1));
+    batch.write(mmio_addrs.W_LENGTH, beats);
+    for (size_t i = start; i < start + beats * beat_bytes;
+         i += sizeof(uint32_t)) {
+      uint32_t word = 0;
+      if (i < size) {
+        memcpy(&word, data + i, std::min(sizeof(uint32_t), size - i));
+      }
+      batch.write(mmio_addrs.W_DATA, word);
+    }
+    simif.issue(batch);
+  }
+}
+
+void loadmem_t::read_mem_bytes(size_t addr, uint8_t *data, size_t size) {
+  if (size == 0 || simif.read_dram(addr, data, size)) {
+    return;
+  }
+
+  const size_t beat_bytes = mem_data_chunk * sizeof(uint32_t);
+  assert(addr % beat_bytes == 0 && size % beat_bytes == 0 &&
+         "unaligned DRAM read");
+
+  // Each beat is requested by writing its address, after which its words are
+  // read from the data queue. Beats are read in batches of requests.
+  std::vector<uint32_t> words(max_request_beats * mem_data_chunk);
+  mmio_batch_t batch;
+  for (size_t offset = 0; offset < size;) {
+    const size_t beats =
+        std::min(max_request_beats, (size - offset) / beat_bytes);
+    batch.clear();
+    for (size_t i = 0; i < beats; i++) {
+      const size_t beat_addr = addr + offset + i * beat_bytes;
+      batch.write(mmio_addrs.R_ADDRESS_H, beat_addr >> 32);
+      batch.write(mmio_addrs.R_ADDRESS_L, beat_addr & ((1ULL << 32) - 1));
+      for (size_t j = 0; j < mem_data_chunk; j++) {
+        batch.read(mmio_addrs.R_DATA, &words[i * mem_data_chunk + j]);
+      }
+    }
+    simif.issue(batch);
+    memcpy(data + offset, words.data(), beats * beat_bytes);
+    offset += beats * beat_bytes;
+  }
+}
+
+memory_image_t loadmem_t::read_dram_image(size_t size) {
+  const size_t page_bytes = 4096;
+  const size_t beat_bytes = mem_data_chunk * sizeof(uint32_t);
+  assert(page_bytes % beat_bytes == 0);
+
+  fprintf(stdout, "[loadmem] reading %zu bytes of DRAM\n", size);
+  memory_image_t image;
+  std::vector<uint8_t> page(page_bytes);
+  for (size_t addr = 0; addr < size; addr += page_bytes) {
+    const size_t n = std::min(page_bytes, size - addr);
+    read_mem_bytes(
+        addr, page.data(), (n + beat_bytes - 1) / beat_bytes * beat_bytes);
+    image.append(addr, page.data(), n);
+  }
+  return image;
+}
+
+void loadmem_t::zero_mem(size_t addr, size_t size) {
+  static const std::vector<uint8_t> zeros(zero_chunk_bytes, 0);
+  while (size != 0) {
+    const size_t n = std::min(size, zeros.size());
+    write_mem_bytes(addr, zeros.data(), n);
+    addr += n;
+    size -= n;
+  }
+}
+
 void loadmem_t::zero_out_dram() {
+  start_zero_out_dram();
+  wait_zero_out_dram();
+}
+
+void loadmem_t::start_zero_out_dram() {
   simif.write(mmio_addrs.ZERO_OUT_DRAM, 1);
+}
+
+void loadmem_t::wait_zero_out_dram() {
   while (!simif.read(mmio_addrs.ZERO_FINISHED))
     ;
+  dram_zeroed = true;
 }
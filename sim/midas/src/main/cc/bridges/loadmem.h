@@ -4,12 +4,15 @@
 #define __LOADMEM_H
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <gmp.h>
 
+#include "core/bitvector.h"
 #include "core/config.h"
+#include "core/memory_image.h"
 #include "core/widget.h"
 
 class simif_t;
@@ -38,22 +41,97 @@ public:
             const AXI4Config &mem_conf,
             unsigned mem_data_chunk);
 
-  void read_mem(size_t addr, mpz_t &value);
-  void write_mem(size_t addr, mpz_t &value);
+  /// Contents of a beat, covering AXI4 data buses of up to 512 bits.
+  using beat_t = bitvector_t<512>;
+
+  beat_t read_mem(size_t addr);
+  void write_mem(size_t addr, const beat_t &value);
   void write_mem_chunk(size_t addr, mpz_t &value, size_t bytes);
 
+  /**
+   * Writes a contiguous range of bytes to DRAM, starting at a beat-aligned
+   * address. The last beat is padded with zeros.
+   *
+   * The platform's direct path to DRAM is used if it has one. Otherwise, the
+   * data is streamed through the widget in long bursts, skipping beats of
+   * zeros if DRAM was zeroed out beforehand.
+   */
+  void write_mem_bytes(size_t addr, const uint8_t *data, size_t size);
+
   // Helper to zero out all DRAM.
   void zero_out_dram();
 
-  // Loads the contents of memory from a file.
+  /**
+   * Starts zeroing out DRAM on the FPGA without waiting for it to finish.
+   *
+   * Other widgets can be accessed while DRAM is being zeroed out, but the
+   * loadmem widget must not be used until `wait_zero_out_dram` returns.
+   */
+  void start_zero_out_dram();
+
+  /**
+   * Waits for DRAM zeroing started by `start_zero_out_dram` to finish.
+   */
+  void wait_zero_out_dram();
+
+  /**
+   * Loads the contents of memory from a hex or ELF file.
+   *
+   * ELF segments are placed at their physical address, relative to the base
+   * of DRAM set by +loadmem-elf-base=<hex>. Regions between segments are not
+   * written to. See `memory_image_t` for the other options.
+   */
   void load_mem_from_file(const std::string &filename);
 
+  /**
+   * Reads an image from a file, preparing it for `write_mem_image`.
+   *
+   * The method performs no MMIO and can run on a thread other than the
+   * driver's, ex. while DRAM is being zeroed out. The image is shared with
+   * the other simulations of the process loading the same file.
+   */
+  std::shared_ptr<const memory_image_t>
+  read_mem_image(const std::string &filename) const;
+
+  /**
+   * Writes an image returned by `read_mem_image` to DRAM.
+   */
+  void write_mem_image(const memory_image_t &image);
+
+  /**
+   * Reads a beat-aligned range of bytes from DRAM.
+   *
+   * Uses the platform's direct path to DRAM if it has one, MMIO otherwise.
+   */
+  void read_mem_bytes(size_t addr, uint8_t *data, size_t size);
+
+  /**
+   * Reads the first `size` bytes of DRAM into an image, recording pages of
+   * zeros without their contents.
+   */
+  memory_image_t read_dram_image(size_t size);
+
+  /**
+   * Returns the size of the address space of a host DRAM channel.
+   */
+  size_t get_channel_size() const { return 1ULL << mem_conf.addr_bits; }
+
   unsigned get_mem_data_chunk() const { return mem_data_chunk; }
 
 private:
   const LOADMEMWIDGET_struct mmio_addrs;
   const AXI4Config mem_conf;
   const unsigned mem_data_chunk;
+  /// Options of the image loader, set through plusargs.
+  const memory_image_options_t image_options;
+
+  /**
+   * Writes zeros to a beat-aligned range of DRAM.
+   */
+  void zero_mem(size_t addr, size_t size);
+
+  /// Set once DRAM is zeroed out, allowing beats of zeros to be skipped.
+  bool dram_zeroed = false;
 };
 
 #endif // __LOADMEM_H
@@ -2,6 +2,8 @@
 
 #include "peek_poke.h"
 
+#include <limits>
+
 char peek_poke_t::KIND;
 
 peek_poke_t::peek_poke_t(simif_t &simif,
@@ -11,29 +13,75 @@ peek_poke_t::peek_poke_t(simif_t &simif,
                          PortMap &&inputs,
                          PortMap &&outputs)
     : widget_t(simif, &KIND), mmio_addrs(mmio_addrs), inputs(std::move(inputs)),
-      outputs(std::move(outputs)) {}
+      outputs(std::move(outputs)),
+      wait_policy(wait_policy_t::from_args(args)) {
+  for (auto &arg : args) {
+    if (arg.find("+peek-poke-transactional") == 0) {
+      transactional = true;
+    }
+  }
+}
+
+peek_poke_t::InputHandle peek_poke_t::input(std::string_view id) const {
+  auto it = inputs.find(id);
+  assert(it != inputs.end() && "missing input port");
+  InputHandle handle;
+  handle.port = &it->second;
+#ifndef NDEBUG
+  handle.owner = this;
+#endif
+  return handle;
+}
+
+peek_poke_t::OutputHandle peek_poke_t::output(std::string_view id) const {
+  auto it = outputs.find(id);
+  assert(it != outputs.end() && "missing output port");
+  OutputHandle handle;
+  handle.port = &it->second;
+#ifndef NDEBUG
+  handle.owner = this;
+#endif
+  return handle;
+}
 
-void peek_poke_t::poke(std::string_view id, uint32_t value, bool blocking) {
+void peek_poke_t::poke(InputHandle handle, uint32_t value, bool blocking) {
   req_timeout = false;
   req_unstable = false;
 
-  auto it = inputs.find(id);
-  assert(it != inputs.end() && "missing input port");
+  const Port &port = resolve(handle);
+
+  if (transactional) {
+    if (blocking && !wait_on_settled(10.0)) {
+      req_timeout = true;
+      return;
+    }
+    pending[port.address] = value;
+    return;
+  }
 
   if (blocking && !wait_on_done(10.0)) {
     req_timeout = true;
     return;
   }
 
-  simif.write(it->second.address, value);
+  simif.write(port.address, value);
 }
 
-uint32_t peek_poke_t::peek(std::string_view id, bool blocking) {
+uint32_t peek_poke_t::peek(OutputHandle handle, bool blocking) {
   req_timeout = false;
   req_unstable = false;
 
-  auto it = outputs.find(id);
-  assert(it != outputs.end() && "missing output port");
+  const Port &port = resolve(handle);
+
+  if (transactional && blocking) {
+    if (!wait_on_settled(10.0)) {
+      req_timeout = true;
+      return 0;
+    }
+    sample_output(port);
+    req_unstable = sampled_unstable;
+    return sampled[port.address];
+  }
 
   if (blocking && !wait_on_done(10.0)) {
     req_timeout = true;
@@ -41,47 +89,118 @@ uint32_t peek_poke_t::peek(std::string_view id, bool blocking) {
   }
 
   req_unstable = blocking && !wait_on_stable_peeks(0.1);
-  return simif.read(it->second.address);
+  return simif.read(port.address);
 }
 
-void peek_poke_t::poke(std::string_view id, mpz_t &value) {
+void peek_poke_t::poke_chunks(InputHandle handle,
+                              const uint32_t *data,
+                              size_t size) {
   req_timeout = false;
   req_unstable = false;
 
-  auto it = inputs.find(id);
-  assert(it != inputs.end() && "missing input port");
-
-  size_t size;
-  uint32_t *data =
-      (uint32_t *)mpz_export(nullptr, &size, -1, sizeof(uint32_t), 0, 0, value);
-  for (size_t i = 0; i < it->second.chunks; i++) {
-    simif.write(it->second.address + (i * sizeof(uint32_t)),
-                i < size ? data[i] : 0);
+  const Port &port = resolve(handle);
+  for (size_t i = 0; i < port.chunks; i++) {
+    const uint64_t addr = port.address + (i * sizeof(uint32_t));
+    if (transactional) {
+      pending[addr] = i < size ? data[i] : 0;
+    } else {
+      simif.write(addr, i < size ? data[i] : 0);
+    }
   }
 }
 
-void peek_poke_t::peek(std::string_view id, mpz_t &value) {
+size_t peek_poke_t::peek_chunks(OutputHandle handle, uint32_t *data) {
   req_timeout = false;
   req_unstable = false;
 
-  auto it = outputs.find(id);
-  assert(it != outputs.end() && "missing output port");
-
-  const size_t size = it->second.chunks;
-  uint32_t data[size];
-  for (size_t i = 0; i < size; i++) {
-    data[i] = simif.read((size_t)it->second.address + (i * sizeof(uint32_t)));
+  const Port &port = resolve(handle);
+  if (transactional && settled) {
+    sample_output(port);
+    for (size_t i = 0; i < port.chunks; i++) {
+      data[i] = sampled[port.address + (i * sizeof(uint32_t))];
+    }
+    return port.chunks;
+  }
+  for (size_t i = 0; i < port.chunks; i++) {
+    data[i] = simif.read((size_t)port.address + (i * sizeof(uint32_t)));
   }
-  mpz_import(value, size, -1, sizeof(uint32_t), 0, 0, data);
+  return port.chunks;
+}
+
+void peek_poke_t::poke(InputHandle handle, mpz_t &value) {
+  std::vector<uint32_t> data((mpz_sizeinbase(value, 2) + 31) / 32);
+  size_t size;
+  mpz_export(data.data(), &size, -1, sizeof(uint32_t), 0, 0, value);
+  poke_chunks(handle, data.data(), size);
+}
+
+void peek_poke_t::peek(OutputHandle handle, mpz_t &value) {
+  std::vector<uint32_t> data(resolve(handle).chunks);
+  const size_t size = peek_chunks(handle, data.data());
+  mpz_import(value, size, -1, sizeof(uint32_t), 0, 0, data.data());
 }
 
 bool peek_poke_t::is_done() { return simif.read(mmio_addrs.DONE); }
 
 void peek_poke_t::step(size_t n, bool blocking) {
-  simif.write(mmio_addrs.STEP, n);
+  const auto start = wait_policy_t::clock::now();
+  if (transactional) {
+    // Write the inputs which changed, followed by the step request.
+    batch.clear();
+    for (auto &[addr, value] : pending) {
+      auto it = committed.find(addr);
+      if (it == committed.end() || it->second != value) {
+        batch.write(addr, value);
+        committed[addr] = value;
+      }
+    }
+    pending.clear();
+    batch.write(mmio_addrs.STEP, n);
+    simif.issue(batch);
+
+    settled = false;
+    stability_checked = false;
+    sampled.clear();
+  } else {
+    simif.write(mmio_addrs.STEP, n);
+  }
 
   if (blocking) {
-    while (!is_done())
-      ;
+    const double expected = step_rate > 0.0 ? n / step_rate : 0.0;
+    unsigned polls = 0;
+    wait_on_done(std::numeric_limits<double>::infinity(), expected, &polls);
+    settled = true;
+
+    // If the step was done by the first poll, it completed while the host
+    // idled through the prediction: the elapsed time measures the idle, not
+    // the target, and feeding it back would only lengthen later predictions.
+    // Shorten the next prediction instead. Otherwise, short steps are
+    // dominated by the latency of MMIO: only estimate the rate of the target
+    // from steps long enough to amortize it.
+    const std::chrono::duration<double> elapsed =
+        wait_policy_t::clock::now() - start;
+    if (expected > 0.0 && polls == 1) {
+      step_rate *= 1.25;
+    } else if (elapsed > std::chrono::milliseconds(1)) {
+      const double rate = n / elapsed.count();
+      step_rate = step_rate > 0.0 ? 0.75 * step_rate + 0.25 * rate : rate;
+    }
+  }
+}
+
+void peek_poke_t::sample_output(const Port &port) {
+  if (!stability_checked) {
+    sampled_unstable = !wait_on_stable_peeks(0.1);
+    stability_checked = true;
+  }
+  if (sampled.count(port.address)) {
+    return;
+  }
+
+  batch.clear();
+  for (size_t i = 0; i < port.chunks; i++) {
+    const uint64_t addr = port.address + (i * sizeof(uint32_t));
+    batch.read(addr, &sampled[addr]);
   }
+  simif.issue(batch);
 }
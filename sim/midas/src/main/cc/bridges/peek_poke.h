@@ -3,11 +3,16 @@
 #ifndef __PEEK_POKE
 #define __PEEK_POKE
 
+#include <cstdio>
+#include <cstdlib>
 #include <gmp.h>
+#include <map>
 #include <string_view>
+#include <unordered_map>
 
+#include "core/bitvector.h"
 #include "core/simif.h"
-#include "core/timing.h"
+#include "core/wait_policy.h"
 
 struct PEEKPOKEBRIDGEMODULE_struct {
   uint64_t STEP;
@@ -23,6 +28,17 @@ struct PEEKPOKEBRIDGEMODULE_struct {
  *
  * Care must be taken to avoid deadlock, since calls to step. must be blocking
  * for peeks and pokes to capture and drive values at the correct cycles.
+ *
+ * With +peek-poke-transactional, pokes are buffered and only written to the
+ * bridge by the next step, in a single batch along with the step request.
+ * Inputs which already hold the poked value are not written again. Once the
+ * target settles after a step, the first blocking peek of an output reads all
+ * of its chunks in a single batch and later peeks of the output are served
+ * from this sample until the next step.
+ *
+ * Status registers are polled according to a `wait_policy_t`. Blocking steps
+ * predict their duration from the rate at which the target advanced during
+ * earlier steps, letting the host idle until the step is almost complete.
  */
 class peek_poke_t final : public widget_t {
 public:
@@ -44,11 +60,66 @@ public:
               PortMap &&outputs);
   ~peek_poke_t() override = default;
 
-  void poke(std::string_view id, uint32_t value, bool blocking);
-  void poke(std::string_view id, mpz_t &value);
+  /**
+   * Port resolved from its name once, through which it is accessed without
+   * further lookups. In debug builds, handles record the bridge which issued
+   * them, which is checked when they are used.
+   */
+  template <bool IsInput>
+  struct PortHandle {
+    const Port *port = nullptr;
+#ifndef NDEBUG
+    const peek_poke_t *owner = nullptr;
+#endif
+  };
+  using InputHandle = PortHandle<true>;
+  using OutputHandle = PortHandle<false>;
+
+  InputHandle input(std::string_view id) const;
+  OutputHandle output(std::string_view id) const;
+
+  void poke(InputHandle handle, uint32_t value, bool blocking);
+  void poke(InputHandle handle, mpz_t &value);
+  void poke(std::string_view id, uint32_t value, bool blocking) {
+    poke(input(id), value, blocking);
+  }
+  void poke(std::string_view id, mpz_t &value) { poke(input(id), value); }
+  template <size_t Bits>
+  void poke(InputHandle handle, const bitvector_t<Bits> &value) {
+    uint32_t data[Bits / 32];
+    value.to_chunks(data, Bits / 32);
+    poke_chunks(handle, data, Bits / 32);
+  }
 
-  uint32_t peek(std::string_view id, bool blocking);
-  void peek(std::string_view id, mpz_t &value);
+  uint32_t peek(OutputHandle handle, bool blocking);
+  void peek(OutputHandle handle, mpz_t &value);
+  uint32_t peek(std::string_view id, bool blocking) {
+    return peek(output(id), blocking);
+  }
+  void peek(std::string_view id, mpz_t &value) { peek(output(id), value); }
+  template <size_t Bits>
+  void peek(OutputHandle handle, bitvector_t<Bits> &value) {
+    if (resolve(handle).chunks * 32 > Bits) {
+      fprintf(stderr,
+              "Port of %zu bits does not fit in a %zu-bit value\n",
+              (size_t)resolve(handle).chunks * 32,
+              Bits);
+      abort();
+    }
+    uint32_t data[Bits / 32];
+    value = bitvector_t<Bits>::from_chunks(data, peek_chunks(handle, data));
+  }
+
+  /**
+   * Pokes the chunks of a wide value, least significant first. Chunks past
+   * `size` are set to zero.
+   */
+  void poke_chunks(InputHandle handle, const uint32_t *data, size_t size);
+
+  /**
+   * Peeks the chunks of a wide value into `data`, returning their number.
+   */
+  size_t peek_chunks(OutputHandle handle, uint32_t *data);
   uint32_t sample_value(std::string_view id) { return peek(id, false); }
 
   /**
@@ -83,16 +154,68 @@ private:
   /// Addresses of output ports.
   const PortMap outputs;
 
-  bool wait_on(size_t flag_addr, double timeout) {
-    midas_time_t start = timestamp();
-    while (!simif.read(flag_addr))
-      if (diff_secs(timestamp(), start) > timeout)
-        return false;
-    return true;
+  /// Set if pokes and peeks are batched around steps.
+  bool transactional = false;
+  /// Set while the target is known to have reached the cycle horizon.
+  bool settled = false;
+  /// Values last written to input chunks, by address.
+  std::unordered_map<uint64_t, uint32_t> committed;
+  /// Values poked since the last step, by address.
+  std::map<uint64_t, uint32_t> pending;
+  /// Values of the output chunks peeked since the target settled.
+  std::unordered_map<uint64_t, uint32_t> sampled;
+  /// Set once the stability of outputs was checked since the last step.
+  bool stability_checked = false;
+  /// Set if the outputs were unstable when sampled.
+  bool sampled_unstable = false;
+  mmio_batch_t batch;
+
+  template <bool IsInput>
+  const Port &resolve(PortHandle<IsInput> handle) const {
+    assert(handle.port && "unresolved port");
+#ifndef NDEBUG
+    assert(handle.owner == this && "port of another bridge");
+#endif
+    return *handle.port;
+  }
+
+  /// Strategy used to poll status registers.
+  const wait_policy_t wait_policy;
+  /// Estimated target cycles stepped per second, 0 if not yet measured.
+  double step_rate = 0.0;
+
+  /**
+   * Reads all chunks of an output in one batch, once the target settled.
+   */
+  void sample_output(const Port &port);
+
+  /**
+   * Waits until the target reaches the cycle horizon, unless it is known to
+   * have done so already.
+   */
+  bool wait_on_settled(double timeout) {
+    if (!settled && wait_on_done(timeout)) {
+      settled = true;
+    }
+    return settled;
+  }
+
+  bool wait_on(size_t flag_addr,
+               double timeout,
+               double expected = 0.0,
+               unsigned *polls = nullptr) {
+    return wait_policy.wait(
+        simif,
+        [&] { return simif.read(flag_addr); },
+        timeout,
+        expected,
+        polls);
   }
 
-  bool wait_on_done(double timeout) {
-    return wait_on(mmio_addrs.DONE, timeout);
+  bool wait_on_done(double timeout,
+                    double expected = 0.0,
+                    unsigned *polls = nullptr) {
+    return wait_on(mmio_addrs.DONE, timeout, expected, polls);
   }
 
   bool wait_on_stable_peeks(double timeout) {
@@ -1,4 +1,6 @@
 #include "plusargs.h"
+#include <algorithm>
+#include <gmp.h>
 #include <iomanip>
 #include <iostream>
 
@@ -66,17 +68,23 @@ plusargs_t::plusargs_t(simif_t &sim,
     }
   }
 
-  mpz_init(value);
-  if (overriden) {
-    mpz_set_str(value, override_value.c_str(), 10);
-  } else {
-    // use the default value from the .h
-    mpz_set_str(value, default_value, 10);
+  const char *value_str =
+      overriden ? override_value.c_str() : default_value; // default from .h
+
+  // parse the value, checking that it fits in the width
+  mpz_t parsed;
+  mpz_init_set_str(parsed, value_str, 10);
+  const bool fits = mpz_sizeinbase(parsed, 2) <= bit_width;
+  value.resize(slice_addrs.size());
+  if (fits) {
+    std::vector<uint32_t> chunks((bit_width + 31) / 32 + 1);
+    size_t size;
+    mpz_export(chunks.data(), &size, -1, sizeof(uint32_t), 0, 0, parsed);
+    std::copy_n(chunks.begin(), std::min(size, value.size()), value.begin());
   }
+  mpz_clear(parsed);
 
-  // check if the given or default value can fit in the width
-  const size_t found_width = mpz_sizeinbase(value, 2);
-  if (found_width > bit_width) {
+  if (!fits) {
     std::cerr << "Value to wide for " << bit_width << " bits\n";
     exit(1);
   }
@@ -111,18 +119,8 @@ uint32_t plusargs_t::slice_address(uint32_t idx) {
  * @retval false The value was default (no PlusArgs matched)
  */
 void plusargs_t::init() {
-  size_t size;
-  const uint32_t *const slice_value =
-      (uint32_t *)mpz_export(nullptr, &size, -1, sizeof(uint32_t), 0, 0, value);
-
-  // write out slices that we have data for using mpz
-  for (size_t i = 0; i < size; i++) {
-    write(slice_address(i), slice_value[i]);
-  }
-
-  // write out the remaining with zeros
-  for (size_t i = size; i < slice_addrs.size(); i++) {
-    write(slice_address(i), 0);
+  for (size_t i = 0; i < slice_addrs.size(); i++) {
+    write(slice_address(i), value[i]);
   }
 
   // after all registers are handled, set this
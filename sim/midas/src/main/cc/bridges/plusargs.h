@@ -4,9 +4,9 @@
 // See LICENSE for license details.
 
 #include "core/bridge_driver.h"
-#include <gmp.h>
 #include <string.h>
 #include <string_view>
+#include <vector>
 
 struct PLUSARGSBRIDGEMODULE_struct {
   uint64_t initDone;
@@ -18,8 +18,8 @@ struct PLUSARGSBRIDGEMODULE_struct {
  * This Bridge Driver talks to a PlusArgs Bridge. This class will determine
  * if the default, or overridden PlusArg value shoud be driven.
  *
- * Arbitrary wide bit widths are supported via
- * MPFR.
+ * Arbitrary wide bit widths are supported: values are parsed through GMP
+ * once, on construction, and kept as slices.
  */
 class plusargs_t : public bridge_driver_t {
 public:
@@ -43,7 +43,7 @@ public:
 
 private:
   const PLUSARGSBRIDGEMODULE_struct mmio_addrs;
-  mpz_t value;            // either the default or the PlusArg value
+  std::vector<uint32_t> value; // slices of the default or the PlusArg value
   bool overriden = false; // true if the PlusArg was found and parsed
   const std::vector<uint32_t> slice_addrs;
 };
@@ -33,6 +33,8 @@ reset_pulse_t::reset_pulse_t(simif_t &sim,
   }
 }
 
+void reset_pulse_t::pulse() { write(mmio_addrs.pulseLength, pulse_length); }
+
 void reset_pulse_t::init() {
   write(mmio_addrs.pulseLength, this->pulse_length);
   write(mmio_addrs.doneInit, 1);
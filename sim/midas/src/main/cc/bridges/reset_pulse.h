@@ -25,7 +25,14 @@ public:
   // Bridge interface
   void init() override;
 
+  /**
+   * Re-asserts reset for the configured pulse length, starting from the next
+   * target cycle.
+   */
+  void pulse();
+
   unsigned get_max_pulse_length() const { return max_pulse_length; }
+  unsigned get_pulse_length() const { return pulse_length; }
 
 private:
   const RESETPULSEBRIDGEMODULE_struct mmio_addrs;
@@ -1,10 +1,14 @@
 #include "synthesized_prints.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 #include <iomanip>
 #include <iostream>
 
+#include "core/phase_controller.h"
+
 char synthesized_prints_t::KIND;
 
 synthesized_prints_t::synthesized_prints_t(
@@ -90,6 +94,9 @@ synthesized_prints_t::synthesized_prints_t(
   this->clock_info.emit_file_header(*(this->printstream));
 
   widths.resize(prints.size());
+  arg_offsets.resize(prints.size());
+  hex_digits.resize(prints.size());
+  dec_digits.resize(prints.size());
   // Used to reconstruct the relative position of arguments in the flattened
   // argument_widths array
   size_t print_bit_offset =
@@ -101,10 +108,14 @@ synthesized_prints_t::synthesized_prints_t(
     auto print_args = new print_vars_t;
     size_t print_width = 1; // A running total of argument widths for this
                             // print, including an enable bit
+    bool wide = false;
 
     // Iterate through the arguments for this print
     for (auto arg_width : print.argument_widths) {
       widths[p_idx].push_back(arg_width);
+      arg_offsets[p_idx].push_back(print_bit_offset % gmp_align_bits +
+                                   print_width);
+      wide |= arg_width > print_value_t::capacity;
 
       mpz_t *mask = (mpz_t *)malloc(sizeof(mpz_t));
       // Below is equivalent to  *mask = (1 << arg_width) - 1
@@ -115,7 +126,11 @@ synthesized_prints_t::synthesized_prints_t(
 
       print_args->data.push_back(mask);
       print_width += arg_width;
+
+      hex_digits[p_idx].push_back(mpz_sizeinbase(*mask, 16));
+      dec_digits[p_idx].push_back(mpz_sizeinbase(*mask, 10));
     }
+    wide_prints.push_back(wide);
 
     size_t aligned_offset = print_bit_offset / gmp_align_bits;
     size_t aligned_msw = (print_width + print_bit_offset) / gmp_align_bits;
@@ -137,6 +152,24 @@ synthesized_prints_t::~synthesized_prints_t() {
   }
 }
 
+void synthesized_prints_t::set_phases(phase_controller_t &phases) {
+  this->phases = &phases;
+
+  const std::string &marker = phases.trigger_marker();
+  trigger_prints.resize(prints.size());
+  for (size_t i = 0; i < prints.size(); i++) {
+    trigger_prints[i] = !marker.empty() &&
+                        strstr(prints[i].format_string, marker.c_str());
+  }
+
+  auto [lo, hi] = phases.detailed_bounds();
+  start_cycle = std::max(start_cycle, clock_info.to_local_cycles(lo));
+  if (hi != UINT64_MAX) {
+    end_cycle = std::min(end_cycle, clock_info.to_local_cycles(hi));
+  }
+  current_cycle = start_cycle;
+}
+
 void synthesized_prints_t::init() {
   // Set the bounds in the widget
   write(mmio_addrs.startCycleL, this->start_cycle);
@@ -146,47 +179,19 @@ void synthesized_prints_t::init() {
   write(mmio_addrs.doneInit, 1);
 }
 
-// Accepts the format string, and the masked arguments, and emits the formatted
-// print to the desired stream
+// Accepts the format string, and emits the formatted print to the desired
+// stream, delegating the formatting of each argument to `emit_arg`
+template <typename F>
 void synthesized_prints_t::print_format(const char *fmt,
-                                        print_vars_t *vars,
-                                        print_vars_t *masks) {
+                                        size_t num_args,
+                                        F &&emit_arg) {
   size_t k = 0;
   if (print_cycle_prefix) {
     *printstream << "CYCLE:" << std::setw(13) << current_cycle << " ";
   }
   while (*fmt) {
     if (*fmt == '%' && fmt[1] != '%') {
-      mpz_t *value = vars->data[k];
-      char *v = nullptr;
-      if (fmt[1] == 's' || fmt[1] == 'c') {
-        size_t size;
-        v = (char *)mpz_export(nullptr, &size, 1, sizeof(char), 0, 0, *value);
-        for (size_t j = 0; j < size; j++)
-          printstream->put(v[j]);
-        fmt++;
-        free(v);
-      } else {
-        char buf[1024];
-        switch (*(++fmt)) {
-        case 'h':
-        case 'x':
-          gmp_sprintf(
-              buf, "%0*Zx", mpz_sizeinbase(*(masks->data[k]), 16), *value);
-          break;
-        case 'd':
-          gmp_sprintf(
-              buf, "%*Zd", mpz_sizeinbase(*(masks->data[k]), 10), *value);
-          break;
-        case 'b':
-          mpz_get_str(buf, 2, *value);
-          break;
-        default:
-          assert(0);
-          break;
-        }
-        (*printstream) << buf;
-      }
+      emit_arg(k, *(++fmt));
       fmt++;
       k++;
     } else if (*fmt == '%') {
@@ -200,7 +205,66 @@ void synthesized_prints_t::print_format(const char *fmt,
       fmt++;
     }
   }
-  assert(k == vars->data.size());
+  assert(k == num_args);
+}
+
+// Formats an argument of a print through GMP
+void synthesized_prints_t::emit_wide_arg(mpz_t &value,
+                                         mpz_t &mask,
+                                         char conversion) {
+  if (conversion == 's' || conversion == 'c') {
+    size_t size;
+    char *v = (char *)mpz_export(nullptr, &size, 1, sizeof(char), 0, 0, value);
+    for (size_t j = 0; j < size; j++)
+      printstream->put(v[j]);
+    free(v);
+    return;
+  }
+
+  char buf[1024];
+  switch (conversion) {
+  case 'h':
+  case 'x':
+    gmp_sprintf(buf, "%0*Zx", mpz_sizeinbase(mask, 16), value);
+    break;
+  case 'd':
+    gmp_sprintf(buf, "%*Zd", mpz_sizeinbase(mask, 10), value);
+    break;
+  case 'b':
+    mpz_get_str(buf, 2, value);
+    break;
+  default:
+    assert(0);
+    break;
+  }
+  (*printstream) << buf;
+}
+
+// Formats an argument of a print which fits in a print_value_t
+void synthesized_prints_t::emit_arg(const print_value_t &value,
+                                    size_t hex_width,
+                                    size_t dec_width,
+                                    char conversion) {
+  switch (conversion) {
+  case 's':
+  case 'c':
+    for (size_t j = (value.bit_length() + 7) / 8; j-- > 0;)
+      printstream->put(value.byte(j));
+    break;
+  case 'h':
+  case 'x':
+    (*printstream) << value.to_hex(hex_width);
+    break;
+  case 'd':
+    (*printstream) << std::setw(dec_width) << value.to_dec();
+    break;
+  case 'b':
+    (*printstream) << value.to_bin();
+    break;
+  default:
+    assert(0);
+    break;
+  }
 }
 
 // Returns true if at least one print in the token is enabled in this cycle
@@ -260,30 +324,64 @@ bool synthesized_prints_t::current_print_enabled(gmp_align_t *buf,
 
 // Finds enabled prints in a token
 void synthesized_prints_t::show_prints(char *buf) {
+  if (phases) {
+    const uint64_t cycle = clock_info.to_base_cycles(current_cycle);
+    if (!phases->detailed(cycle)) {
+      // Only look for triggers while fast-forwarding.
+      for (size_t i = 0; i < prints.size(); i++) {
+        gmp_align_t *data = ((gmp_align_t *)buf) + aligned_offsets[i];
+        if (trigger_prints[i] && current_print_enabled(data, bit_offset[i])) {
+          phases->trigger(cycle);
+          break;
+        }
+      }
+      if (!phases->detailed(cycle)) {
+        return;
+      }
+    }
+  }
+
   for (size_t i = 0; i < prints.size(); i++) {
     gmp_align_t *data = ((gmp_align_t *)buf) + aligned_offsets[i];
     // First bit is enable
-    if (current_print_enabled(data, bit_offset[i])) {
-      mpz_t print;
-      mpz_init(print);
-      mpz_import(print, sizes[i], -1, sizeof(gmp_align_t), 0, 0, data);
-      mpz_fdiv_q_2exp(print, print, bit_offset[i] + 1);
-
-      print_vars_t vars;
-      size_t num_args = prints[i].argument_widths.size();
+    if (!current_print_enabled(data, bit_offset[i])) {
+      continue;
+    }
+
+    const size_t num_args = prints[i].argument_widths.size();
+    if (!wide_prints[i]) {
+      // Extract the arguments directly from the token
+      print_values.clear();
       for (size_t arg = 0; arg < num_args; arg++) {
-        mpz_t *var = (mpz_t *)malloc(sizeof(mpz_t));
-        mpz_t *mask = masks[i]->data[arg];
-        mpz_init(*var);
-        // *var = print & *mask
-        mpz_and(*var, print, *mask);
-        vars.data.push_back(var);
-        // print = print >> width
-        mpz_fdiv_q_2exp(print, print, widths[i][arg]);
+        print_values.push_back(print_value_t::extract(
+            data, arg_offsets[i][arg], widths[i][arg]));
       }
-      print_format(prints[i].format_string, &vars, masks[i]);
-      mpz_clear(print);
+      print_format(prints[i].format_string, num_args, [&](size_t k, char c) {
+        emit_arg(print_values[k], hex_digits[i][k], dec_digits[i][k], c);
+      });
+      continue;
+    }
+
+    mpz_t print;
+    mpz_init(print);
+    mpz_import(print, sizes[i], -1, sizeof(gmp_align_t), 0, 0, data);
+    mpz_fdiv_q_2exp(print, print, bit_offset[i] + 1);
+
+    print_vars_t vars;
+    for (size_t arg = 0; arg < num_args; arg++) {
+      mpz_t *var = (mpz_t *)malloc(sizeof(mpz_t));
+      mpz_t *mask = masks[i]->data[arg];
+      mpz_init(*var);
+      // *var = print & *mask
+      mpz_and(*var, print, *mask);
+      vars.data.push_back(var);
+      // print = print >> width
+      mpz_fdiv_q_2exp(print, print, widths[i][arg]);
     }
+    print_format(prints[i].format_string, num_args, [&](size_t k, char c) {
+      emit_wide_arg(*vars.data[k], *masks[i]->data[k], c);
+    });
+    mpz_clear(print);
   }
 }
 
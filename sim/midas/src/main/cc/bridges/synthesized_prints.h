@@ -1,13 +1,16 @@
 #ifndef __SYNTHESIZED_PRINTS_H
 #define __SYNTHESIZED_PRINTS_H
 
-#include <fstream>
 #include <gmp.h>
 #include <iostream>
 #include <vector>
 
+#include "core/bitvector.h"
 #include "core/bridge_driver.h"
 #include "core/clock_info.h"
+#include "core/output_file.h"
+
+class phase_controller_t;
 
 // Bridge Driver Instantiation Template
 struct print_vars_t {
@@ -59,6 +62,12 @@ public:
 
   void flush();
 
+  /**
+   * Restricts prints to the detailed phases of the simulation, narrowing the
+   * window in which the hardware emits prints to the scheduled phases.
+   */
+  void set_phases(phase_controller_t &phases);
+
 private:
   const PRINTBRIDGEMODULE_struct mmio_addrs;
   const std::vector<Print> prints;
@@ -84,7 +93,7 @@ private:
   const size_t gmp_align_bits = sizeof(gmp_align_t) * 8;
 
   // +arg driven members
-  std::ofstream printfile; // Used only if the +print-file arg is provided
+  output_file_t printfile; // Used only if the +print-file arg is provided
   std::string default_filename = "synthesized-prints.out";
 
   std::ostream *printstream; // Is set to std::cerr otherwise
@@ -94,6 +103,11 @@ private:
   bool human_readable = true;
   bool print_cycle_prefix = true;
 
+  // Phase schedule, if prints are only shown in detailed phases.
+  phase_controller_t *phases = nullptr;
+  // Flags prints which trigger a detailed phase.
+  std::vector<bool> trigger_prints;
+
   std::vector<std::vector<size_t>> widths;
   std::vector<size_t> sizes;
   std::vector<print_vars_t *> masks;
@@ -101,10 +115,28 @@ private:
   std::vector<size_t> aligned_offsets; // Aligned to gmp_align_t
   std::vector<size_t> bit_offset;
 
+  // Arguments are extracted into bit vectors, unless one of the arguments of
+  // the print is wider than their capacity, in which case GMP is used
+  using print_value_t = bitvector_t<256>;
+  std::vector<bool> wide_prints;
+  // Offsets of arguments relative to the aligned offset of their print
+  std::vector<std::vector<size_t>> arg_offsets;
+  // Number of digits of each argument in hexadecimal and decimal
+  std::vector<std::vector<size_t>> hex_digits;
+  std::vector<std::vector<size_t>> dec_digits;
+  // Arguments of the print being formatted
+  std::vector<print_value_t> print_values;
+
   bool current_print_enabled(gmp_align_t *buf, size_t offset);
   size_t process_tokens(size_t beats, size_t minimum_batch_beats);
   void show_prints(char *buf);
-  void print_format(const char *fmt, print_vars_t *vars, print_vars_t *masks);
+  template <typename F>
+  void print_format(const char *fmt, size_t num_args, F &&emit_arg);
+  void emit_wide_arg(mpz_t &value, mpz_t &mask, char conversion);
+  void emit_arg(const print_value_t &value,
+                size_t hex_width,
+                size_t dec_width,
+                char conversion);
   // Returns the number of beats available, once two successive reads return the
   // same value
   int beats_avaliable_stable();
@@ -19,6 +19,19 @@ public:
   AddressMap(const std::vector<std::pair<std::string, uint32_t>> &read,
              const std::vector<std::pair<std::string, uint32_t>> &write);
 
+  // Handle to a register, resolved from its name once so that accesses on
+  // hot paths need no lookups. In debug builds, handles record the map which
+  // issued them, which is checked when they are used.
+  template <bool Writable>
+  struct Handle {
+    uint32_t addr = 0;
+#ifndef NDEBUG
+    const AddressMap *owner = nullptr;
+#endif
+  };
+  using ReadHandle = Handle<false>;
+  using WriteHandle = Handle<true>;
+
   // Look up register address based on name
   uint32_t r_addr(const std::string &name) const {
     auto it = r_registers.find(name);
@@ -27,10 +40,22 @@ public:
   };
   uint32_t w_addr(const std::string &name) const {
     auto it = w_registers.find(name);
-    assert(it != r_registers.end() && "missing register");
+    assert(it != w_registers.end() && "missing register");
     return it->second;
   };
 
+  // Resolve a register into a handle
+  ReadHandle r_handle(const std::string &name) const {
+    return make_handle<false>(r_addr(name));
+  }
+  WriteHandle w_handle(const std::string &name) const {
+    return make_handle<true>(w_addr(name));
+  }
+
+  // Look up register address based on a handle
+  uint32_t r_addr(ReadHandle handle) const { return resolve(handle); }
+  uint32_t w_addr(WriteHandle handle) const { return resolve(handle); }
+
   // Check for register presence
   bool r_reg_exists(const std::string &name) const {
     return r_registers.find(name) != r_registers.end();
@@ -42,6 +67,25 @@ public:
   // Register name -> register addresses
   const std::map<std::string, uint32_t> r_registers;
   const std::map<std::string, uint32_t> w_registers;
+
+private:
+  template <bool Writable>
+  Handle<Writable> make_handle(uint32_t addr) const {
+    Handle<Writable> handle;
+    handle.addr = addr;
+#ifndef NDEBUG
+    handle.owner = this;
+#endif
+    return handle;
+  }
+
+  template <bool Writable>
+  uint32_t resolve(Handle<Writable> handle) const {
+#ifndef NDEBUG
+    assert(handle.owner == this && "register of another address map");
+#endif
+    return handle.addr;
+  }
 };
 
 #endif // __ADDRESS_MAP_H
@@ -0,0 +1,298 @@
+// See LICENSE for license details.
+
+#ifndef __BITVECTOR_H
+#define __BITVECTOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * Unsigned integer of up to `Bits` bits, stored inline.
+ *
+ * Bridges exchange wide values with the FPGA as sequences of 32-bit chunks,
+ * which are usually no wider than a few hundred bits. Unlike GMP integers,
+ * bit vectors never allocate, which keeps them cheap on hot paths. Bits past
+ * the capacity are discarded by shifts and arithmetic. Code handling values
+ * of unbounded width should check the width against `capacity` and fall back
+ * to GMP for wider values.
+ */
+template <size_t Bits>
+class bitvector_t final {
+  static_assert(Bits > 0 && Bits % 64 == 0,
+                "capacity must be a multiple of 64 bits");
+
+public:
+  static constexpr size_t capacity = Bits;
+  static constexpr size_t num_words = Bits / 64;
+
+  constexpr bitvector_t() = default;
+  constexpr explicit bitvector_t(uint64_t value) : words{value} {}
+
+  /**
+   * Builds a value from `count` 32-bit chunks, least significant first.
+   * Chunks past the capacity must be zero.
+   */
+  static bitvector_t from_chunks(const uint32_t *chunks, size_t count) {
+    bitvector_t v;
+    for (size_t i = 0; i < count; i++) {
+      if (i / 2 < num_words) {
+        v.words[i / 2] |= (uint64_t)chunks[i] << (32 * (i % 2));
+      } else {
+        assert(chunks[i] == 0 && "value exceeds capacity");
+      }
+    }
+    return v;
+  }
+
+  /**
+   * Writes the `count` least significant 32-bit chunks of the value.
+   */
+  void to_chunks(uint32_t *chunks, size_t count) const {
+    for (size_t i = 0; i < count; i++) {
+      chunks[i] = i / 2 < num_words ? words[i / 2] >> (32 * (i % 2)) : 0;
+    }
+  }
+
+  /**
+   * Extracts the `width` bits starting at bit `lsb` of a buffer of 64-bit
+   * words, least significant first.
+   */
+  static bitvector_t extract(const uint64_t *buf, size_t lsb, size_t width) {
+    assert(width <= Bits && "value exceeds capacity");
+    bitvector_t v;
+    const uint64_t *src = buf + lsb / 64;
+    const size_t shift = lsb % 64;
+    for (size_t i = 0; i * 64 < width; i++) {
+      uint64_t word = src[i] >> shift;
+      if (shift != 0 && i * 64 + 64 - shift < width) {
+        word |= src[i + 1] << (64 - shift);
+      }
+      v.words[i] = word;
+    }
+    v.truncate(width);
+    return v;
+  }
+
+  /**
+   * Returns a value with the `width` least significant bits set.
+   */
+  static bitvector_t mask(size_t width) {
+    bitvector_t v;
+    for (size_t i = 0; i < num_words; i++) {
+      v.words[i] = ~0ULL;
+    }
+    v.truncate(width);
+    return v;
+  }
+
+  /**
+   * Parses a number in base 2, 10 or 16, returning nothing if the string
+   * holds an invalid digit or the value does not fit.
+   */
+  static std::optional<bitvector_t> parse(std::string_view str,
+                                          unsigned base) {
+    if (str.empty()) {
+      return std::nullopt;
+    }
+    bitvector_t v;
+    for (char c : str) {
+      unsigned digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+      } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+      } else {
+        return std::nullopt;
+      }
+      if (digit >= base || v.mul_add(base, digit) != 0) {
+        return std::nullopt;
+      }
+    }
+    return v;
+  }
+
+  uint64_t to_u64() const { return words[0]; }
+
+  bool bit(size_t i) const {
+    return i < Bits && (words[i / 64] >> (i % 64)) & 1;
+  }
+
+  bool is_zero() const {
+    for (size_t i = 0; i < num_words; i++) {
+      if (words[i] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Returns the number of significant bits, 0 for zero.
+   */
+  size_t bit_length() const {
+    for (size_t i = num_words; i-- > 0;) {
+      if (words[i] != 0) {
+        return i * 64 + 64 - __builtin_clzll(words[i]);
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Returns byte `i` of the value, counting from the least significant.
+   */
+  uint8_t byte(size_t i) const { return words[i / 8] >> (8 * (i % 8)); }
+
+  /**
+   * Clears all bits from position `width` onwards.
+   */
+  void truncate(size_t width) {
+    for (size_t i = 0; i < num_words; i++) {
+      if (width <= i * 64) {
+        words[i] = 0;
+      } else if (width < i * 64 + 64) {
+        words[i] &= (1ULL << (width % 64)) - 1;
+      }
+    }
+  }
+
+  /**
+   * Computes `this * m + a` in place, returning the bits shifted out.
+   */
+  uint64_t mul_add(uint64_t m, uint64_t a) {
+    unsigned __int128 carry = a;
+    for (size_t i = 0; i < num_words; i++) {
+      carry += (unsigned __int128)words[i] * m;
+      words[i] = (uint64_t)carry;
+      carry >>= 64;
+    }
+    return (uint64_t)carry;
+  }
+
+  /**
+   * Divides the value by `d` in place, returning the remainder.
+   */
+  uint64_t div_mod(uint64_t d) {
+    unsigned __int128 rem = 0;
+    for (size_t i = num_words; i-- > 0;) {
+      rem = (rem << 64) | words[i];
+      words[i] = (uint64_t)(rem / d);
+      rem %= d;
+    }
+    return (uint64_t)rem;
+  }
+
+  bitvector_t &operator>>=(size_t n) {
+    const size_t w = n / 64, s = n % 64;
+    for (size_t i = 0; i < num_words; i++) {
+      uint64_t lo = i + w < num_words ? words[i + w] : 0;
+      uint64_t hi = i + w + 1 < num_words ? words[i + w + 1] : 0;
+      words[i] = s == 0 ? lo : (lo >> s) | (hi << (64 - s));
+    }
+    return *this;
+  }
+
+  bitvector_t &operator<<=(size_t n) {
+    const size_t w = n / 64, s = n % 64;
+    for (size_t i = num_words; i-- > 0;) {
+      uint64_t hi = i >= w ? words[i - w] : 0;
+      uint64_t lo = i >= w + 1 ? words[i - w - 1] : 0;
+      words[i] = s == 0 ? hi : (hi << s) | (lo >> (64 - s));
+    }
+    return *this;
+  }
+
+  bitvector_t &operator&=(const bitvector_t &o) {
+    for (size_t i = 0; i < num_words; i++) {
+      words[i] &= o.words[i];
+    }
+    return *this;
+  }
+
+  bitvector_t &operator|=(const bitvector_t &o) {
+    for (size_t i = 0; i < num_words; i++) {
+      words[i] |= o.words[i];
+    }
+    return *this;
+  }
+
+  friend bitvector_t operator>>(bitvector_t v, size_t n) { return v >>= n; }
+  friend bitvector_t operator<<(bitvector_t v, size_t n) { return v <<= n; }
+  friend bitvector_t operator&(bitvector_t a, const bitvector_t &b) {
+    return a &= b;
+  }
+  friend bitvector_t operator|(bitvector_t a, const bitvector_t &b) {
+    return a |= b;
+  }
+
+  friend bool operator==(const bitvector_t &a, const bitvector_t &b) = default;
+
+  friend std::strong_ordering operator<=>(const bitvector_t &a,
+                                          const bitvector_t &b) {
+    for (size_t i = num_words; i-- > 0;) {
+      if (a.words[i] != b.words[i]) {
+        return a.words[i] <=> b.words[i];
+      }
+    }
+    return std::strong_ordering::equal;
+  }
+
+  /**
+   * Formats the value in hexadecimal, padded with zeros to `digits`.
+   */
+  std::string to_hex(size_t digits = 1) const {
+    static const char hex[] = "0123456789abcdef";
+    const size_t n = std::max<size_t>((bit_length() + 3) / 4, digits);
+    std::string str(n, '0');
+    for (size_t i = 0; i < n && i < Bits / 4; i++) {
+      str[n - 1 - i] = hex[(words[i / 16] >> (4 * (i % 16))) & 0xf];
+    }
+    return str;
+  }
+
+  /**
+   * Formats the value in binary.
+   */
+  std::string to_bin() const {
+    const size_t n = std::max<size_t>(bit_length(), 1);
+    std::string str(n, '0');
+    for (size_t i = 0; i < n; i++) {
+      str[n - 1 - i] = '0' + bit(i);
+    }
+    return str;
+  }
+
+  /**
+   * Formats the value in decimal.
+   */
+  std::string to_dec() const {
+    // Peel off 19 digits at a time, the most which fit in a 64-bit word.
+    constexpr uint64_t base = 10000000000000000000ULL;
+    bitvector_t v = *this;
+    std::string str;
+    do {
+      uint64_t rem = v.div_mod(base);
+      for (int i = 0; i < 19; i++) {
+        str.push_back('0' + rem % 10);
+        rem /= 10;
+      }
+    } while (!v.is_zero());
+    while (str.size() > 1 && str.back() == '0') {
+      str.pop_back();
+    }
+    return std::string(str.rbegin(), str.rend());
+  }
+
+private:
+  uint64_t words[num_words] = {};
+};
+
+#endif // __BITVECTOR_H
@@ -0,0 +1,167 @@
+// See LICENSE for license details.
+
+#include "fmr_profile.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <typeinfo>
+
+#include "bridges/clock.h"
+#include "core/bridge_driver.h"
+#include "core/widget_registry.h"
+
+/**
+ * Returns a readable name for the type of a bridge.
+ */
+static std::string bridge_name(bridge_driver_t &bridge) {
+  const char *mangled = typeid(bridge).name();
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+  std::string name = status == 0 ? demangled : mangled;
+  free(demangled);
+  return name;
+}
+
+std::unique_ptr<fmr_profile_t>
+fmr_profile_t::from_args(widget_registry_t &registry,
+                         clockmodule_t &clock,
+                         const std::vector<std::string> &args) {
+  std::string path_arg = std::string("+fmr-profile=");
+  std::string interval_arg = std::string("+fmr-profile-interval-ms=");
+
+  std::string path;
+  std::chrono::milliseconds interval(100);
+  for (auto &arg : args) {
+    if (arg.find(path_arg) == 0) {
+      path = arg.substr(path_arg.length());
+    }
+    if (arg.find(interval_arg) == 0) {
+      interval = std::chrono::milliseconds(
+          atol(arg.c_str() + interval_arg.length()));
+    }
+  }
+  if (path.empty()) {
+    return nullptr;
+  }
+  return std::make_unique<fmr_profile_t>(registry, clock, path, interval);
+}
+
+fmr_profile_t::fmr_profile_t(widget_registry_t &registry,
+                             clockmodule_t &clock,
+                             const std::string &path,
+                             std::chrono::milliseconds interval)
+    : registry(registry), clock(clock), interval(interval), file(path) {}
+
+void fmr_profile_t::start_profile() {
+  // Columns are laid out on the first tick rather than on construction, once
+  // the top has registered the bridges it builds itself.
+  for (auto *bridge : registry.get_all_bridges()) {
+    columns.emplace(bridge, names.size());
+    names.push_back(bridge_name(*bridge) + "_" + std::to_string(names.size()));
+  }
+  interval_busy.resize(names.size());
+  total_busy.resize(names.size());
+  total_stalls.resize(names.size() + 1);
+
+  file << "time_s,target_cycles,host_cycles,fmr";
+  for (auto &name : names) {
+    file << "," << name << "_service_s";
+  }
+  file << ",driver_loop_service_s" << std::endl;
+
+  started = true;
+  profile_start = sample();
+  start_interval(profile_start);
+}
+
+fmr_profile_t::sample_t fmr_profile_t::sample() {
+  clock.sample();
+  return {steady::now(), clock.cached_tcycle(), clock.cached_hcycle()};
+}
+
+void fmr_profile_t::start_interval(const sample_t &now) {
+  interval_start = now;
+  std::fill(interval_busy.begin(), interval_busy.end(), steady::duration(0));
+}
+
+void fmr_profile_t::end_interval() {
+  const sample_t end = sample();
+  const uint64_t tcycles = end.tcycle - interval_start.tcycle;
+  const uint64_t hcycles = end.hcycle - interval_start.hcycle;
+  const double wall =
+      std::chrono::duration<double>(end.time - interval_start.time).count();
+
+  file << std::chrono::duration<double>(end.time - profile_start.time).count()
+       << "," << tcycles << "," << hcycles << ",";
+  if (tcycles != 0) {
+    file << (double)hcycles / tcycles;
+  }
+
+  // Estimate the stalls of each bridge from its share of the service time.
+  const double stalls = hcycles > tcycles ? hcycles - tcycles : 0;
+  double busy = 0.0;
+  for (size_t i = 0; i < names.size(); i++) {
+    const double t = std::chrono::duration<double>(interval_busy[i]).count();
+    file << "," << t;
+    busy += t;
+    total_busy[i] += interval_busy[i];
+    if (wall > 0) {
+      total_stalls[i] += stalls * t / wall;
+    }
+  }
+  const double loop = std::max(wall - busy, 0.0);
+  file << "," << loop << std::endl;
+  if (wall > 0) {
+    total_stalls.back() += stalls * loop / wall;
+  }
+
+  start_interval(end);
+}
+
+void fmr_profile_t::finish() {
+  if (started) {
+    end_interval();
+  }
+  file.close();
+}
+
+void fmr_profile_t::print_summary() const {
+  fprintf(stderr, "\nEstimated FMR Attribution (by service time)\n");
+  fprintf(stderr, "------------------------------\n");
+  if (!started) {
+    fprintf(stderr, "No bridge ticks were profiled.\n");
+    return;
+  }
+
+  const uint64_t tcycles = interval_start.tcycle - profile_start.tcycle;
+  const double wall = std::chrono::duration<double>(interval_start.time -
+                                                    profile_start.time)
+                          .count();
+  if (tcycles == 0 || wall <= 0) {
+    fprintf(stderr, "The target did not advance while profiling.\n");
+    return;
+  }
+
+  fprintf(stderr, "Target Cycles Profiled: %" PRIu64 "\n", tcycles);
+  auto print_row = [&](const std::string &name, double busy, double stalls) {
+    fprintf(stderr,
+            "  %-40s %6.1f%% of time, est. FMR +%.2f\n",
+            name.c_str(),
+            100.0 * busy / wall,
+            stalls / tcycles);
+  };
+  double busy = 0.0;
+  for (size_t i = 0; i < names.size(); i++) {
+    const double t = std::chrono::duration<double>(total_busy[i]).count();
+    print_row(names[i], t, total_stalls[i]);
+    busy += t;
+  }
+  print_row("driver loop", std::max(wall - busy, 0.0), total_stalls.back());
+  fprintf(stderr,
+          "Note: These are estimates: stalls are split in proportion to the "
+          "wallclock time the driver spent servicing each bridge, not measured "
+          "by the target.\n");
+}
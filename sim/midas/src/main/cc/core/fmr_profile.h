@@ -0,0 +1,126 @@
+// See LICENSE for license details.
+
+#ifndef __FMR_PROFILE_H
+#define __FMR_PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/output_file.h"
+
+class bridge_driver_t;
+class clockmodule_t;
+class widget_registry_t;
+
+/**
+ * Breaks the FMR of a simulation down over time and across bridges.
+ *
+ * Enabled with +fmr-profile=<path>. Every tick of a bridge issued through
+ * `simulation_t::tick_bridge` is timed. Every +fmr-profile-interval-ms=<n>
+ * milliseconds (100 by default) the host and target cycle counters are
+ * sampled and a row is appended to the CSV file at <path>, holding the FMR of
+ * the interval and the wallclock time the driver spent ticking each bridge,
+ * in `<bridge>_service_s` columns. The remaining time is spent by the driver
+ * loop itself, stepping the target and polling for completion.
+ *
+ * The target stalls whenever it waits for a token from the driver. The host
+ * cycles of an interval in excess of its target cycles are attributed to
+ * bridges in proportion to the time the driver spent servicing them: while
+ * the driver ticks one bridge, it cannot service the others. This is an
+ * estimate, since the hardware does not report which token the target was
+ * waiting on, and it does not capture stalls internal to the FPGA, such as
+ * those of FASED timing models. A summary of the estimated attribution is
+ * printed at the end of the simulation.
+ */
+class fmr_profile_t final {
+public:
+  /**
+   * Creates the profiler if the plusargs request one.
+   */
+  static std::unique_ptr<fmr_profile_t>
+  from_args(widget_registry_t &registry,
+            clockmodule_t &clock,
+            const std::vector<std::string> &args);
+
+  fmr_profile_t(widget_registry_t &registry,
+                clockmodule_t &clock,
+                const std::string &path,
+                std::chrono::milliseconds interval);
+
+  /**
+   * Times a tick of a bridge, performed by invoking `tick`.
+   */
+  template <typename F>
+  void tick_bridge(bridge_driver_t &bridge, F &&tick) {
+    if (!started) {
+      start_profile();
+    }
+    const auto start = steady::now();
+    tick();
+    const auto end = steady::now();
+
+    auto it = columns.find(&bridge);
+    if (it != columns.end()) {
+      interval_busy[it->second] += end - start;
+    }
+    if (end - interval_start.time >= interval) {
+      end_interval();
+    }
+  }
+
+  /**
+   * Closes the last interval. Must be called when the simulation ends.
+   */
+  void finish();
+
+  /**
+   * Prints the attribution of the FMR over the whole simulation.
+   */
+  void print_summary() const;
+
+private:
+  using steady = std::chrono::steady_clock;
+
+  struct sample_t {
+    steady::time_point time;
+    uint64_t tcycle = 0;
+    uint64_t hcycle = 0;
+  };
+
+  /**
+   * Starts the profile, assigning a column to each bridge.
+   */
+  void start_profile();
+
+  sample_t sample();
+  void start_interval(const sample_t &now);
+  void end_interval();
+
+  widget_registry_t &registry;
+  clockmodule_t &clock;
+  const std::chrono::milliseconds interval;
+  output_file_t file;
+
+  /// Names of bridges, by column.
+  std::vector<std::string> names;
+  /// Column of each bridge in the profile.
+  std::unordered_map<bridge_driver_t *, size_t> columns;
+
+  /// Counters at the start of the profile and of the current interval.
+  sample_t profile_start;
+  sample_t interval_start;
+  bool started = false;
+
+  /// Time spent ticking each bridge during the current interval.
+  std::vector<steady::duration> interval_busy;
+  /// Time spent ticking each bridge over the whole profile.
+  std::vector<steady::duration> total_busy;
+  /// Estimated stall cycles of each bridge, with the driver loop last.
+  std::vector<double> total_stalls;
+};
+
+#endif // __FMR_PROFILE_H
@@ -0,0 +1,242 @@
+// See LICENSE for license details.
+
+#include "host_trace.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// Identifies trace files, followed by the version of the format.
+static const char trace_magic[] = "FSTRACE";
+static const uint8_t trace_version = 1;
+
+std::unique_ptr<host_trace_t>
+host_trace_t::from_args(const std::vector<std::string> &args,
+                        const char *target_name) {
+  std::string record_arg = std::string("+trace-record=");
+  std::string replay_arg = std::string("+trace-replay=");
+
+  for (auto &arg : args) {
+    if (arg.find(record_arg) == 0) {
+      return std::make_unique<host_trace_t>(
+          arg.substr(record_arg.length()), false, target_name);
+    }
+    if (arg.find(replay_arg) == 0) {
+      return std::make_unique<host_trace_t>(
+          output_service_t::resolve_path(arg.substr(replay_arg.length())),
+          true,
+          target_name);
+    }
+  }
+  return nullptr;
+}
+
+host_trace_t::host_trace_t(const std::string &path,
+                           bool replay,
+                           const char *target_name)
+    : path(path), replay(replay) {
+  const std::string name(target_name ? target_name : "");
+
+  if (!replay) {
+    file.open(path, std::ios_base::out | std::ios_base::binary);
+    if (!file.is_open()) {
+      fprintf(stderr, "Cannot open trace: %s\n", path.c_str());
+      abort();
+    }
+    file.write(trace_magic, sizeof(trace_magic) - 1);
+    file.put(trace_version);
+    file.write(name.c_str(), name.size() + 1);
+    return;
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "Cannot open trace: %s\n", path.c_str());
+    abort();
+  }
+  length = st.st_size;
+  if (length > 0) {
+    void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      fprintf(stderr, "Cannot map trace: %s\n", path.c_str());
+      abort();
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+    base = static_cast<const uint8_t *>(map);
+  }
+  ::close(fd);
+
+  const size_t magic_length = sizeof(trace_magic) - 1;
+  if (length < magic_length + 1 || memcmp(base, trace_magic, magic_length) ||
+      base[magic_length] != trace_version) {
+    fprintf(stderr, "Not a trace or unsupported version: %s\n", path.c_str());
+    abort();
+  }
+  offset = magic_length + 1;
+
+  // The header ends with the null-terminated name of the target.
+  const void *end = memchr(base + offset, '\0', length - offset);
+  if (!end) {
+    diverged("truncated trace");
+  }
+  const std::string recorded(reinterpret_cast<const char *>(base + offset));
+  if (recorded != name) {
+    fprintf(stderr,
+            "Trace %s was recorded from target %s, not %s\n",
+            path.c_str(),
+            recorded.c_str(),
+            name.c_str());
+    abort();
+  }
+  offset = static_cast<const uint8_t *>(end) - base + 1;
+}
+
+host_trace_t::~host_trace_t() {
+  if (!replay) {
+    file.close();
+    fprintf(stderr,
+            "Recorded %" PRIu64 " host events to %s\n",
+            events,
+            path.c_str());
+    return;
+  }
+  if (offset != length) {
+    fprintf(stderr,
+            "Replay of %s stopped after %" PRIu64
+            " events, before the end of the trace\n",
+            path.c_str(),
+            events);
+  }
+  if (base) {
+    munmap(const_cast<uint8_t *>(base), length);
+  }
+}
+
+const char *host_trace_t::event_name(event_t event) {
+  switch (event) {
+  case event_t::READ:
+    return "read";
+  case event_t::WRITE:
+    return "write";
+  case event_t::READ_DRAM:
+    return "DRAM read";
+  case event_t::WRITE_DRAM:
+    return "DRAM write";
+  case event_t::PULL:
+    return "stream pull";
+  case event_t::PUSH:
+    return "stream push";
+  case event_t::FLUSH:
+    return "stream flush";
+  }
+  return "unknown event";
+}
+
+void host_trace_t::emit(event_t event,
+                        std::initializer_list<uint64_t> fields,
+                        const void *payload,
+                        size_t size) {
+  // A tag followed by at most 4 fields of up to 10 bytes each.
+  char buf[1 + 4 * 10];
+  size_t n = 0;
+  buf[n++] = static_cast<char>(event);
+  for (uint64_t field : fields) {
+    do {
+      const uint8_t byte = field & 0x7f;
+      field >>= 7;
+      buf[n++] = byte | (field ? 0x80 : 0);
+    } while (field);
+  }
+  file.write(buf, n);
+  if (payload) {
+    file.write(static_cast<const char *>(payload), size);
+  }
+  ++events;
+}
+
+void host_trace_t::expect(event_t event, uint64_t key) {
+  if (offset >= length) {
+    fprintf(stderr,
+            "Replay of %s ran past the end of the trace at event %" PRIu64
+            ": driver issued a %s of 0x%" PRIx64 "\n",
+            path.c_str(),
+            events,
+            event_name(event),
+            key);
+    abort();
+  }
+  const auto recorded = static_cast<event_t>(base[offset++]);
+  const uint64_t recorded_key = take_varint();
+  if (recorded != event || recorded_key != key) {
+    fprintf(stderr,
+            "Replay of %s diverged at event %" PRIu64
+            ": driver issued a %s of 0x%" PRIx64
+            ", trace holds a %s of 0x%" PRIx64 "\n",
+            path.c_str(),
+            events,
+            event_name(event),
+            key,
+            event_name(recorded),
+            recorded_key);
+    abort();
+  }
+  ++events;
+}
+
+void host_trace_t::expect_value(uint64_t value) {
+  const uint64_t recorded = take_varint();
+  if (recorded != value) {
+    fprintf(stderr,
+            "Replay of %s diverged at event %" PRIu64 ": driver used 0x%" PRIx64
+            ", trace holds 0x%" PRIx64 "\n",
+            path.c_str(),
+            events,
+            value,
+            recorded);
+    abort();
+  }
+}
+
+void host_trace_t::check_size(size_t bytes, size_t num_bytes) {
+  if (bytes > num_bytes) {
+    diverged("stream transfer larger than the request");
+  }
+}
+
+uint64_t host_trace_t::take_varint() {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (offset >= length) {
+      diverged("truncated trace");
+    }
+    const uint8_t byte = base[offset++];
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  diverged("malformed trace");
+}
+
+void host_trace_t::take_payload(void *dest, size_t size) {
+  if (length - offset < size) {
+    diverged("truncated trace");
+  }
+  memcpy(dest, base + offset, size);
+  offset += size;
+}
+
+void host_trace_t::diverged(const char *what) {
+  fprintf(stderr,
+          "Replay of %s failed at event %" PRIu64 ": %s\n",
+          path.c_str(),
+          events,
+          what);
+  abort();
+}
@@ -0,0 +1,225 @@
+// See LICENSE for license details.
+
+#ifndef __HOST_TRACE_H
+#define __HOST_TRACE_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/output_file.h"
+
+/**
+ * Trace of the traffic between the driver and the FPGA.
+ *
+ * Recording a simulation captures everything the driver observes of the
+ * FPGA: the values of MMIO reads, the payloads of stream pulls, the amount of
+ * data accepted by stream pushes and the results of direct DRAM accesses.
+ * Replaying the trace serves these responses back to the same driver without
+ * an FPGA, reproducing the exact behaviour of a production run offline and at
+ * the full speed of the host, which makes it possible to profile the driver
+ * against real traffic.
+ *
+ * Traces are enabled through plusargs:
+ *   +trace-record=<path>  records the traffic of the simulation to <path>.
+ *   +trace-replay=<path>  replays a trace instead of connecting to an FPGA.
+ *
+ * Events are encoded compactly, with a tag byte followed by LEB128-encoded
+ * addresses, values and sizes, and the raw payloads of streams and DRAM
+ * reads. Writes issued by the driver are recorded along with their values and
+ * checked during replay: replay aborts as soon as the driver diverges from
+ * the trace. Features driven by wallclock time, such as telemetry or the FMR
+ * profiler, sample counters over MMIO at timing-dependent points and must be
+ * disabled in both recorded and replayed runs. For the same reason, the clock
+ * bridge ignores +clock-max-staleness-us and reads its counters on every use
+ * while a trace is open.
+ */
+class host_trace_t final {
+public:
+  /**
+   * Opens the trace requested by the plusargs, if any.
+   */
+  static std::unique_ptr<host_trace_t>
+  from_args(const std::vector<std::string> &args, const char *target_name);
+
+  /**
+   * Opens a trace for recording or, if `replay` is set, for replay. Traces
+   * record the name of the target they were captured from.
+   */
+  host_trace_t(const std::string &path, bool replay, const char *target_name);
+  ~host_trace_t();
+
+  bool replaying() const { return replay; }
+
+  /**
+   * Records the value returned by `read`, or returns it from the trace.
+   */
+  template <typename F>
+  uint32_t read(size_t addr, F &&read) {
+    if (replay) {
+      expect(event_t::READ, addr);
+      return take_varint();
+    }
+    const uint32_t data = read();
+    if (!suspended) {
+      emit(event_t::READ, {addr, data});
+    }
+    return data;
+  }
+
+  /**
+   * Records a write performed by `write`, or checks it against the trace.
+   */
+  template <typename F>
+  void write(size_t addr, uint32_t data, F &&write) {
+    if (replay) {
+      expect(event_t::WRITE, addr);
+      expect_value(data);
+      return;
+    }
+    write();
+    if (!suspended) {
+      emit(event_t::WRITE, {addr, data});
+    }
+  }
+
+  /**
+   * Records a DRAM read performed by `read` into `data`, or copies it out of
+   * the trace.
+   */
+  template <typename F>
+  bool read_dram(uint64_t addr, uint8_t *data, size_t size, F &&read) {
+    if (replay) {
+      expect(event_t::READ_DRAM, addr);
+      expect_value(size);
+      const bool ok = take_varint();
+      if (ok) {
+        take_payload(data, size);
+      }
+      return ok;
+    }
+    const bool ok = read();
+    emit(event_t::READ_DRAM, {addr, size, ok}, ok ? data : nullptr, size);
+    return ok;
+  }
+
+  /**
+   * Records the outcome of a DRAM write performed by `write`.
+   */
+  template <typename F>
+  bool write_dram(uint64_t addr, size_t size, F &&write) {
+    if (replay) {
+      expect(event_t::WRITE_DRAM, addr);
+      expect_value(size);
+      return take_varint();
+    }
+    const bool ok = write();
+    emit(event_t::WRITE_DRAM, {addr, size, ok});
+    return ok;
+  }
+
+  /**
+   * Records the data dequeued from a stream by `pull` into `dest`, or copies
+   * it out of the trace. MMIO accesses performed by `pull` are not recorded.
+   */
+  template <typename F>
+  size_t pull(uint32_t stream, void *dest, size_t num_bytes, F &&pull) {
+    if (replay) {
+      expect(event_t::PULL, stream);
+      const size_t bytes = take_varint();
+      check_size(bytes, num_bytes);
+      take_payload(dest, bytes);
+      return bytes;
+    }
+    const size_t bytes = suspend(pull);
+    emit(event_t::PULL, {stream, bytes}, dest, bytes);
+    return bytes;
+  }
+
+  /**
+   * Records the number of bytes enqueued into a stream by `push`.
+   */
+  template <typename F>
+  size_t push(uint32_t stream, size_t num_bytes, F &&push) {
+    if (replay) {
+      expect(event_t::PUSH, stream);
+      const size_t bytes = take_varint();
+      check_size(bytes, num_bytes);
+      return bytes;
+    }
+    const size_t bytes = suspend(push);
+    emit(event_t::PUSH, {stream, bytes});
+    return bytes;
+  }
+
+  /**
+   * Records a flush of a stream performed by `flush`.
+   */
+  template <typename F>
+  void flush(uint32_t stream, F &&flush) {
+    if (replay) {
+      expect(event_t::FLUSH, stream);
+      return;
+    }
+    suspend(flush);
+    emit(event_t::FLUSH, {stream});
+  }
+
+private:
+  enum class event_t : uint8_t {
+    READ,
+    WRITE,
+    READ_DRAM,
+    WRITE_DRAM,
+    PULL,
+    PUSH,
+    FLUSH,
+  };
+
+  static const char *event_name(event_t event);
+
+  /**
+   * Invokes a stream operation, hiding the MMIO accesses it performs: they
+   * are replaced by the outcome of the operation in the trace.
+   */
+  template <typename F>
+  auto suspend(F &&f) {
+    struct guard_t {
+      unsigned &depth;
+      ~guard_t() { --depth; }
+    } guard{++suspended};
+    return f();
+  }
+
+  void emit(event_t event,
+            std::initializer_list<uint64_t> fields,
+            const void *payload = nullptr,
+            size_t size = 0);
+
+  void expect(event_t event, uint64_t key);
+  void expect_value(uint64_t value);
+  void check_size(size_t bytes, size_t num_bytes);
+  uint64_t take_varint();
+  void take_payload(void *dest, size_t size);
+  [[noreturn]] void diverged(const char *what);
+
+  const std::string path;
+  const bool replay;
+
+  /// Recorded trace.
+  output_file_t file;
+  /// Depth of nested stream operations hiding MMIO accesses.
+  unsigned suspended = 0;
+
+  /// Replayed trace, mapped into memory.
+  const uint8_t *base = nullptr;
+  size_t length = 0;
+  size_t offset = 0;
+
+  /// Number of events processed.
+  uint64_t events = 0;
+};
+
+#endif // __HOST_TRACE_H
@@ -0,0 +1,538 @@
+// See LICENSE for license details.
+
+#include "memory_image.h"
+
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Magic number at the start of snapshot files.
+static constexpr char snapshot_magic[8] = {
+    'F', 'S', 'I', 'M', 'D', 'R', 'A', 'M'};
+static constexpr uint32_t snapshot_version = 1;
+
+/**
+ * Read-only mapping of a whole file.
+ */
+class mapped_file_t final {
+public:
+  explicit mapped_file_t(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      fprintf(stderr, "[memory_image] cannot open %s\n", path.c_str());
+      exit(EXIT_FAILURE);
+    }
+    size = st.st_size;
+    if (size != 0) {
+      data = (const char *)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        fprintf(stderr, "[memory_image] cannot map %s\n", path.c_str());
+        exit(EXIT_FAILURE);
+      }
+      madvise((void *)data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+  }
+
+  ~mapped_file_t() {
+    if (size != 0)
+      munmap((void *)data, size);
+  }
+
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+static std::vector<uint8_t> read_file(const std::string &path) {
+  mapped_file_t file(path);
+  return std::vector<uint8_t>(file.data, file.data + file.size);
+}
+
+/**
+ * Decodes a line of hex digits holding a little-endian number: the last two
+ * digits encode the first byte. Returns false if a character is not a digit.
+ */
+static bool decode_hex_line(const char *line, size_t length, uint8_t *out) {
+  const size_t bytes = length / 2;
+  const char *digits = line + length;
+  size_t i = 0;
+  bool valid = true;
+
+#ifdef __SSE2__
+  // Decode 16 digits into 8 bytes at a time. The value of a digit is its low
+  // nibble, plus 9 for letters. Pairs of digits are combined in 16-bit lanes.
+  const __m128i below_0 = _mm_set1_epi8('0' - 1);
+  const __m128i above_9 = _mm_set1_epi8('9' + 1);
+  const __m128i below_a = _mm_set1_epi8('a' - 1);
+  const __m128i above_f = _mm_set1_epi8('f' + 1);
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i nibble = _mm_set1_epi8(0xF);
+  const __m128i letter_offset = _mm_set1_epi8(9);
+  const __m128i low_byte = _mm_set1_epi16(0xFF);
+  __m128i digit_mask = _mm_set1_epi8(-1);
+  for (; i + 8 <= bytes; i += 8) {
+    digits -= 16;
+    __m128i c = _mm_loadu_si128((const __m128i *)digits);
+    __m128i lower = _mm_or_si128(c, case_bit);
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, below_0),
+                                     _mm_cmpgt_epi8(above_9, c));
+    __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(lower, below_a),
+                                      _mm_cmpgt_epi8(above_f, lower));
+    digit_mask =
+        _mm_and_si128(digit_mask, _mm_or_si128(is_digit, is_letter));
+
+    __m128i v = _mm_add_epi8(_mm_and_si128(c, nibble),
+                             _mm_and_si128(is_letter, letter_offset));
+    __m128i pairs = _mm_and_si128(
+        _mm_or_si128(_mm_slli_epi16(v, 4), _mm_srli_epi16(v, 8)), low_byte);
+    uint64_t packed =
+        _mm_cvtsi128_si64(_mm_packus_epi16(pairs, _mm_setzero_si128()));
+    // The last pair of digits holds the first byte.
+    packed = __builtin_bswap64(packed);
+    memcpy(out + i, &packed, sizeof(packed));
+  }
+  valid = _mm_movemask_epi8(digit_mask) == 0xFFFF;
+#endif
+
+  for (; i < bytes; i++) {
+    digits -= 2;
+    uint8_t byte = 0;
+    for (int j = 0; j < 2; j++) {
+      char c = digits[j];
+      uint8_t value;
+      if (c >= '0' && c <= '9') {
+        value = c - '0';
+      } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        value = (c | 0x20) - 'a' + 10;
+      } else {
+        value = 0;
+        valid = false;
+      }
+      byte = (byte << 4) | value;
+    }
+    out[i] = byte;
+  }
+  return valid;
+}
+
+/**
+ * Calls `f(line, length)` on all lines in [begin, end).
+ */
+template <typename F>
+static void for_each_line(const char *begin, const char *end, F f) {
+  while (begin < end) {
+    const char *eol = (const char *)memchr(begin, '\n', end - begin);
+    if (!eol)
+      eol = end;
+    f(begin, eol - begin);
+    begin = eol + 1;
+  }
+}
+
+memory_image_t memory_image_t::load(const std::string &path,
+                                    const memory_image_options_t &options) {
+  if (is_elf(path)) {
+    return load_elf(path, options.elf_base);
+  }
+  if (is_snapshot(path)) {
+    return load_snapshot(path);
+  }
+  std::string cache = binary_cache(path, options);
+  if (!cache.empty()) {
+    return load_binary(cache);
+  }
+  return load_hex(path);
+}
+
+std::shared_ptr<const memory_image_t>
+memory_image_t::load_shared(const std::string &path,
+                            const memory_image_options_t &options,
+                            uint64_t alignment) {
+  struct entry_t {
+    std::mutex mutex;
+    std::weak_ptr<const memory_image_t> image;
+  };
+  using key_t = std::tuple<std::string, uint64_t, bool, uint64_t>;
+  static std::mutex entries_mutex;
+  static std::map<key_t, std::shared_ptr<entry_t>> entries;
+
+  std::shared_ptr<entry_t> entry;
+  {
+    std::lock_guard<std::mutex> lock(entries_mutex);
+    auto &slot = entries[{path, options.elf_base, options.cache, alignment}];
+    if (!slot) {
+      slot = std::make_shared<entry_t>();
+    }
+    entry = slot;
+  }
+
+  // Holding the lock of the entry while loading makes concurrent requests
+  // for the same image wait for this one.
+  std::lock_guard<std::mutex> lock(entry->mutex);
+  if (auto image = entry->image.lock()) {
+    return image;
+  }
+  auto image = std::make_shared<memory_image_t>(load(path, options));
+  image->align(alignment);
+  entry->image = image;
+  return image;
+}
+
+memory_image_options_t
+memory_image_t::parse_args(const std::vector<std::string> &args) {
+  std::string elf_base_arg = std::string("+loadmem-elf-base=");
+  memory_image_options_t options;
+  for (auto &arg : args) {
+    if (arg.find(elf_base_arg) == 0) {
+      options.elf_base =
+          strtoull(arg.c_str() + elf_base_arg.length(), nullptr, 16);
+    }
+    if (arg.find("+loadmem-cache") == 0) {
+      options.cache = true;
+    }
+  }
+  return options;
+}
+
+std::string
+memory_image_t::binary_cache(const std::string &path,
+                             const memory_image_options_t &options) {
+  if (!options.cache || is_elf(path) || is_snapshot(path)) {
+    return "";
+  }
+
+  const std::string cache = path + ".bin";
+  struct stat hex_st, cache_st;
+  if (stat(path.c_str(), &hex_st) < 0) {
+    fprintf(stderr, "[memory_image] cannot open %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  }
+  if (stat(cache.c_str(), &cache_st) == 0 &&
+      std::tie(cache_st.st_mtim.tv_sec, cache_st.st_mtim.tv_nsec) >=
+          std::tie(hex_st.st_mtim.tv_sec, hex_st.st_mtim.tv_nsec)) {
+    return cache;
+  }
+
+  // Write to a temporary file first so that simulations loading the same
+  // image concurrently never observe a partially written cache.
+  memory_image_t image = load_hex(path);
+  const auto &data = image.segments[0].data;
+  const std::string tmp = cache + "." + std::to_string(getpid());
+  FILE *file = fopen(tmp.c_str(), "wb");
+  if (!file || fwrite(data.data(), 1, data.size(), file) != data.size() ||
+      fclose(file) != 0 || rename(tmp.c_str(), cache.c_str()) != 0) {
+    fprintf(stderr,
+            "[memory_image] cannot write cache %s, using %s\n",
+            cache.c_str(),
+            path.c_str());
+    unlink(tmp.c_str());
+    return "";
+  }
+  return cache;
+}
+
+bool memory_image_t::is_elf(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[SELFMAG];
+  return file.read(magic, SELFMAG) && memcmp(magic, ELFMAG, SELFMAG) == 0;
+}
+
+bool memory_image_t::is_snapshot(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(snapshot_magic)];
+  return file.read(magic, sizeof(magic)) &&
+         memcmp(magic, snapshot_magic, sizeof(magic)) == 0;
+}
+
+void memory_image_t::append(uint64_t addr, const uint8_t *data, size_t size) {
+  const bool zero = !data || std::all_of(data, data + size, [](uint8_t b) {
+    return b == 0;
+  });
+  if (segments.empty() || (!zero && segments.back().zero_bytes != 0)) {
+    segments.push_back(memory_segment_t{addr, {}, 0});
+  }
+
+  auto &segment = segments.back();
+  assert(addr == segment.end() && "ranges must be appended in order");
+  if (zero) {
+    segment.zero_bytes += size;
+  } else {
+    segment.data.insert(segment.data.end(), data, data + size);
+  }
+}
+
+void memory_image_t::save(const std::string &path) const {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "[memory_image] cannot open %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  bool ok = fwrite(snapshot_magic, sizeof(snapshot_magic), 1, file) == 1 &&
+            fwrite(&snapshot_version, sizeof(snapshot_version), 1, file) == 1;
+  for (auto &segment : segments) {
+    const uint64_t header[3] = {
+        segment.addr, segment.data.size(), segment.zero_bytes};
+    ok = ok && fwrite(header, sizeof(header), 1, file) == 1 &&
+         fwrite(segment.data.data(), 1, segment.data.size(), file) ==
+             segment.data.size();
+  }
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "[memory_image] cannot write %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  }
+}
+
+memory_image_t memory_image_t::load_hex(const std::string &path) {
+  mapped_file_t file(path);
+  const char *begin = file.data;
+  const char *end = file.data + file.size;
+
+  // Split the file into chunks of whole lines, decoded in parallel. A first
+  // pass sizes the output of each chunk, a second one decodes the lines.
+  const size_t min_chunk_size = 1 << 20;
+  const size_t nchunks =
+      std::clamp<size_t>(file.size / min_chunk_size,
+                         1,
+                         std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<const char *> bounds{begin};
+  for (size_t i = 1; i < nchunks; i++) {
+    const char *split =
+        std::max(bounds.back(), begin + file.size * i / nchunks);
+    const char *eol = (const char *)memchr(split, '\n', end - split);
+    bounds.push_back(eol ? eol + 1 : end);
+  }
+  bounds.push_back(end);
+
+  auto parallel = [&](auto f) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nchunks; i++) {
+      threads.emplace_back(f, i);
+    }
+    f(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  };
+
+  std::vector<size_t> offsets(nchunks + 1, 0);
+  parallel([&](size_t i) {
+    size_t bytes = 0;
+    for_each_line(bounds[i], bounds[i + 1], [&](const char *, size_t length) {
+      bytes += length / 2;
+    });
+    offsets[i + 1] = bytes;
+  });
+  for (size_t i = 0; i < nchunks; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  memory_segment_t segment{0, std::vector<uint8_t>(offsets[nchunks]), 0};
+  std::atomic<bool> valid = true;
+  parallel([&](size_t i) {
+    uint8_t *out = segment.data.data() + offsets[i];
+    bool chunk_valid = true;
+    for_each_line(
+        bounds[i], bounds[i + 1], [&](const char *line, size_t length) {
+          chunk_valid &= decode_hex_line(line, length, out);
+          out += length / 2;
+        });
+    if (!chunk_valid)
+      valid = false;
+  });
+  if (!valid) {
+    fprintf(stderr, "[memory_image] invalid hex digit in %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  memory_image_t image;
+  image.segments.push_back(std::move(segment));
+  return image;
+}
+
+memory_image_t memory_image_t::load_binary(const std::string &path) {
+  memory_image_t image;
+  image.segments.push_back(memory_segment_t{0, read_file(path), 0});
+  return image;
+}
+
+memory_image_t memory_image_t::load_snapshot(const std::string &path) {
+  mapped_file_t file(path);
+  auto malformed = [&] {
+    fprintf(stderr, "[memory_image] malformed snapshot %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  };
+
+  size_t offset = sizeof(snapshot_magic);
+  uint32_t version;
+  if (file.size < offset + sizeof(version))
+    malformed();
+  memcpy(&version, file.data + offset, sizeof(version));
+  if (version != snapshot_version)
+    malformed();
+  offset += sizeof(version);
+
+  memory_image_t image;
+  while (offset < file.size) {
+    uint64_t header[3];
+    if (file.size - offset < sizeof(header))
+      malformed();
+    memcpy(header, file.data + offset, sizeof(header));
+    offset += sizeof(header);
+    if (file.size - offset < header[1])
+      malformed();
+    const uint8_t *data = (const uint8_t *)file.data + offset;
+    image.segments.push_back(memory_segment_t{
+        header[0], std::vector<uint8_t>(data, data + header[1]), header[2]});
+    offset += header[1];
+  }
+  return image;
+}
+
+/**
+ * Collects the PT_LOAD segments of an ELF file of either class.
+ */
+template <typename Ehdr, typename Phdr>
+static void load_elf_segments(const std::string &path,
+                              const std::vector<uint8_t> &file,
+                              uint64_t elf_base,
+                              std::vector<memory_segment_t> &segments) {
+  auto malformed = [&] {
+    fprintf(stderr, "[memory_image] malformed ELF file %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  };
+
+  if (file.size() < sizeof(Ehdr))
+    malformed();
+  Ehdr ehdr;
+  memcpy(&ehdr, file.data(), sizeof(ehdr));
+  if (ehdr.e_phentsize != sizeof(Phdr) ||
+      ehdr.e_phoff + (uint64_t)ehdr.e_phnum * sizeof(Phdr) > file.size())
+    malformed();
+
+  for (unsigned i = 0; i < ehdr.e_phnum; i++) {
+    Phdr phdr;
+    memcpy(&phdr, file.data() + ehdr.e_phoff + i * sizeof(Phdr), sizeof(phdr));
+    if (phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+      continue;
+    if (phdr.p_filesz > phdr.p_memsz ||
+        phdr.p_offset + (uint64_t)phdr.p_filesz > file.size())
+      malformed();
+    if (phdr.p_paddr < elf_base) {
+      fprintf(stderr,
+              "[memory_image] segment at 0x%llx of %s is below the base of "
+              "DRAM (0x%llx), see +loadmem-elf-base\n",
+              (unsigned long long)phdr.p_paddr,
+              path.c_str(),
+              (unsigned long long)elf_base);
+      exit(EXIT_FAILURE);
+    }
+
+    const uint8_t *data = file.data() + phdr.p_offset;
+    segments.push_back(memory_segment_t{
+        phdr.p_paddr - elf_base,
+        std::vector<uint8_t>(data, data + phdr.p_filesz),
+        phdr.p_memsz - phdr.p_filesz});
+  }
+}
+
+memory_image_t memory_image_t::load_elf(const std::string &path,
+                                        uint64_t elf_base) {
+  const std::vector<uint8_t> file = read_file(path);
+  if (file.size() < EI_NIDENT || file[EI_DATA] != ELFDATA2LSB) {
+    fprintf(stderr,
+            "[memory_image] %s is not a little-endian ELF file\n",
+            path.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  memory_image_t image;
+  switch (file[EI_CLASS]) {
+  case ELFCLASS32:
+    load_elf_segments<Elf32_Ehdr, Elf32_Phdr>(
+        path, file, elf_base, image.segments);
+    break;
+  case ELFCLASS64:
+    load_elf_segments<Elf64_Ehdr, Elf64_Phdr>(
+        path, file, elf_base, image.segments);
+    break;
+  default:
+    fprintf(stderr, "[memory_image] unknown ELF class in %s\n", path.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::sort(image.segments.begin(),
+            image.segments.end(),
+            [](const auto &a, const auto &b) { return a.addr < b.addr; });
+  for (size_t i = 1; i < image.segments.size(); i++) {
+    if (image.segments[i].addr < image.segments[i - 1].end()) {
+      fprintf(stderr,
+              "[memory_image] overlapping segments in %s\n",
+              path.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+  return image;
+}
+
+void memory_image_t::align(uint64_t alignment) {
+  std::vector<memory_segment_t> aligned;
+  for (auto &segment : segments) {
+    auto align_up = [&](uint64_t addr) {
+      return (addr + alignment - 1) / alignment * alignment;
+    };
+    const uint64_t start = segment.addr / alignment * alignment;
+    const uint64_t end = align_up(segment.end());
+    const uint64_t data_end = align_up(segment.addr + segment.data.size());
+    segment.data.resize(data_end - segment.addr, 0);
+    segment.zero_bytes = end - data_end;
+    segment.data.insert(segment.data.begin(), segment.addr - start, 0);
+    segment.addr = start;
+
+    // Segments sharing the first block of this one were padded with zeros
+    // over it. Since segments are disjoint, each byte of the block belongs
+    // to at most one of them: fold their bytes into the padding of this one.
+    while (!aligned.empty() && aligned.back().end() > segment.addr) {
+      auto &last = aligned.back();
+      const uint64_t overlap = last.end() - segment.addr;
+      if (last.zero_bytes >= overlap) {
+        last.zero_bytes -= overlap;
+      } else {
+        const uint64_t data_end =
+            std::min(last.addr + last.data.size(),
+                     segment.addr + segment.data.size());
+        for (uint64_t addr = segment.addr; addr < data_end; addr++) {
+          segment.data[addr - segment.addr] |= last.data[addr - last.addr];
+        }
+        last.data.resize(segment.addr - last.addr);
+        last.zero_bytes = 0;
+      }
+      if (last.data.empty() && last.zero_bytes == 0) {
+        aligned.pop_back();
+      } else {
+        break;
+      }
+    }
+    aligned.push_back(std::move(segment));
+  }
+  segments = std::move(aligned);
+}
@@ -0,0 +1,136 @@
+// See LICENSE for license details.
+
+#ifndef __MEMORY_IMAGE_H
+#define __MEMORY_IMAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Contiguous region of memory initialized by an image.
+ */
+struct memory_segment_t {
+  /// Offset of the segment into DRAM.
+  uint64_t addr;
+  /// Initial contents of the segment.
+  std::vector<uint8_t> data;
+  /// Number of bytes following `data` which must be zero (ex. `.bss`).
+  uint64_t zero_bytes = 0;
+
+  uint64_t end() const { return addr + data.size() + zero_bytes; }
+};
+
+/**
+ * Options of the memory image loader, set through plusargs:
+ *   +loadmem-elf-base=<hex>  physical address of DRAM for ELF images
+ *   +loadmem-cache           caches decoded hex images in <file>.bin
+ */
+struct memory_image_options_t {
+  /// Physical address of DRAM in the target's address space.
+  uint64_t elf_base = 0x80000000ULL;
+  /// Set if decoded hex images are cached.
+  bool cache = false;
+};
+
+/**
+ * Initial contents of DRAM, described as a sorted list of disjoint segments.
+ *
+ * Images are loaded either from hex files, where each line holds a
+ * little-endian number and which are loaded densely from address 0, or from
+ * ELF files. Only the PT_LOAD segments of ELF files are loaded, at their
+ * physical addresses relative to the base address of DRAM. Regions not
+ * covered by any segment are left untouched by loaders.
+ *
+ * Snapshots of DRAM are stored in a sparse binary format, as a header
+ * followed by one record per segment: its address, the size of its data,
+ * the number of zero bytes following the data, and the data itself.
+ *
+ * Hex files are memory-mapped and decoded by multiple threads. Since decoding
+ * large images still takes a while, the decoded contents of a hex file can be
+ * cached in a binary file next to it, which is reused as long as it is newer
+ * than the hex file.
+ */
+class memory_image_t final {
+public:
+  /**
+   * Parses the options of the loader from plusargs.
+   */
+  static memory_image_options_t
+  parse_args(const std::vector<std::string> &args);
+
+  /**
+   * Loads an image, detecting its format from the contents of the file.
+   *
+   * Aborts if the file cannot be read or is malformed.
+   */
+  static memory_image_t
+  load(const std::string &path,
+       const memory_image_options_t &options = memory_image_options_t());
+
+  /**
+   * Loads an image and aligns it to `alignment`, sharing the result with all
+   * other users of the process requesting the same image.
+   *
+   * Drivers hosting the simulations of several FPGA slots parse each file
+   * once: concurrent requests wait for the first one to complete. Images are
+   * released once no longer referenced.
+   */
+  static std::shared_ptr<const memory_image_t>
+  load_shared(const std::string &path,
+              const memory_image_options_t &options,
+              uint64_t alignment);
+
+  /**
+   * If caching is enabled and `path` is a hex file, returns the path of an
+   * up-to-date binary copy of its contents, creating it if necessary. The
+   * copy holds the dense contents of memory starting at address 0. Returns
+   * an empty string otherwise.
+   */
+  static std::string binary_cache(const std::string &path,
+                                  const memory_image_options_t &options);
+
+  /**
+   * Checks whether a file starts with the ELF magic number.
+   */
+  static bool is_elf(const std::string &path);
+
+  /**
+   * Checks whether a file is a snapshot written by `save`.
+   */
+  static bool is_snapshot(const std::string &path);
+
+  /**
+   * Appends a range of memory following the end of the image. Ranges of
+   * zeros, or ranges passed without `data`, only extend the zero bytes of the
+   * last segment.
+   */
+  void append(uint64_t addr, const uint8_t *data, size_t size);
+
+  /**
+   * Writes the image to a snapshot file, which `load` accepts.
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * Pads segments with zeros to start and end on multiples of `alignment`,
+   * merging segments which end up sharing an aligned block.
+   */
+  void align(uint64_t alignment);
+
+  /**
+   * Returns the address past the last byte initialized by the image.
+   */
+  uint64_t end() const { return segments.empty() ? 0 : segments.back().end(); }
+
+  std::vector<memory_segment_t> segments;
+
+private:
+  static memory_image_t load_hex(const std::string &path);
+  static memory_image_t load_binary(const std::string &path);
+  static memory_image_t load_snapshot(const std::string &path);
+  static memory_image_t load_elf(const std::string &path, uint64_t elf_base);
+};
+
+#endif // __MEMORY_IMAGE_H
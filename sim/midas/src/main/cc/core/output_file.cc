@@ -0,0 +1,409 @@
+// See LICENSE for license details.
+
+#include "output_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
+
+/// Alignment of the buffers, sizes and offsets of O_DIRECT writes.
+static constexpr size_t direct_io_alignment = 4096;
+
+/// Directory of the relative paths opened by the thread, empty for the cwd.
+static thread_local std::string thread_directory;
+
+output_service_t &output_service_t::instance() {
+  static output_service_t service;
+  return service;
+}
+
+output_service_t::~output_service_t() {
+  // Files owned by bridges are still open at exit, as bridges are never
+  // destroyed. Write out whatever they have buffered before shutting down.
+  sync_all();
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    stop = true;
+  }
+  cond.notify_one();
+  if (thread.joinable()) {
+    thread.join();
+  }
+
+  for (auto &file : files) {
+    ::close(file->fd);
+    free(file->staging);
+  }
+}
+
+void output_service_t::configure(const std::vector<std::string> &args) {
+  std::string buffer_size_arg = std::string("+output-buffer-size=");
+  for (auto &arg : args) {
+    if (arg.find("+output-sync") == 0) {
+      async = false;
+    }
+    if (arg.find("+output-direct-io") == 0) {
+      direct = true;
+    }
+    if (arg.find(buffer_size_arg) == 0) {
+      size_t size = atol(arg.c_str() + buffer_size_arg.length());
+      buffer_size = std::max(size, direct_io_alignment);
+    }
+  }
+  // O_DIRECT writes are issued in multiples of the alignment.
+  buffer_size = (buffer_size + direct_io_alignment - 1) /
+                direct_io_alignment * direct_io_alignment;
+}
+
+void output_service_t::sync_all() {
+  std::vector<std::shared_ptr<file_state_t>> snapshot;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    snapshot = files;
+  }
+  for (auto &file : snapshot) {
+    if (file->flush_producer) {
+      file->flush_producer();
+    }
+    sync(*file);
+  }
+}
+
+void output_service_t::sync_thread() {
+  const auto self = std::this_thread::get_id();
+  std::vector<std::shared_ptr<file_state_t>> owned;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto &file : files) {
+      if (file->owner == self) {
+        owned.push_back(file);
+      }
+    }
+  }
+  for (auto &file : owned) {
+    if (file->flush_producer) {
+      file->flush_producer();
+    }
+    sync(*file);
+  }
+}
+
+void output_service_t::set_thread_directory(const std::string &dir) {
+  std::error_code error;
+  std::filesystem::create_directories(dir, error);
+  if (error) {
+    fprintf(stderr,
+            "[output] cannot create %s: %s\n",
+            dir.c_str(),
+            error.message().c_str());
+    abort();
+  }
+  thread_directory = dir;
+}
+
+std::string output_service_t::resolve_path(const std::string &path) {
+  if (thread_directory.empty() || path.empty() || path[0] == '/') {
+    return path;
+  }
+  return thread_directory + "/" + path;
+}
+
+std::shared_ptr<output_service_t::file_state_t>
+output_service_t::open(const std::string &relative_path,
+                       bool append,
+                       std::function<void()> &&flush) {
+  const std::string path = resolve_path(relative_path);
+
+  auto file = std::make_shared<file_state_t>();
+  file->path = path;
+  file->owner = std::this_thread::get_id();
+  file->flush_producer = std::move(flush);
+
+  int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+  // Not all file systems support direct IO: fall back to buffered writes.
+  if (direct && !append) {
+    file->fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    if (file->fd >= 0) {
+      file->direct = true;
+      if (posix_memalign(
+              (void **)&file->staging, direct_io_alignment, buffer_size)) {
+        fprintf(stderr, "[output] cannot allocate staging buffer\n");
+        abort();
+      }
+    }
+  }
+  if (file->fd < 0) {
+    file->fd = ::open(path.c_str(), flags, 0644);
+  }
+  if (file->fd < 0) {
+    return nullptr;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  files.push_back(file);
+  if (async && !thread.joinable()) {
+    thread = std::thread([this] { writer_loop(); });
+  }
+  return file;
+}
+
+void output_service_t::close(const std::shared_ptr<file_state_t> &file) {
+  sync(*file);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    files.erase(std::find(files.begin(), files.end(), file));
+  }
+  ::close(file->fd);
+  free(file->staging);
+  file->staging = nullptr;
+}
+
+std::unique_ptr<char[]> output_service_t::submit(file_state_t &file,
+                                                 chunk_t &&chunk) {
+  if (!async) {
+    write_chunk(file, chunk);
+    return std::move(chunk.data);
+  }
+
+  std::unique_ptr<char[]> next;
+  {
+    std::unique_lock<std::mutex> lock(file.mutex);
+    file.drained.wait(lock, [&] { return file.pending.size() < max_pending; });
+    file.pending.push_back(std::move(chunk));
+    if (!file.recycled.empty()) {
+      next = std::move(file.recycled.back());
+      file.recycled.pop_back();
+    }
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    work = true;
+  }
+  cond.notify_one();
+
+  if (!next) {
+    next.reset(new char[buffer_size]);
+  }
+  return next;
+}
+
+void output_service_t::sync(file_state_t &file) {
+  std::unique_lock<std::mutex> lock(file.mutex);
+  file.drained.wait(lock,
+                    [&] { return file.pending.empty() && !file.writing; });
+  if (file.direct) {
+    write_staged(file, true);
+  }
+  ::fsync(file.fd);
+}
+
+void output_service_t::writer_loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cond.wait(lock, [&] { return work || stop; });
+    if (!work) {
+      break;
+    }
+    work = false;
+    auto snapshot = files;
+    lock.unlock();
+
+    for (auto &file : snapshot) {
+      std::deque<chunk_t> chunks;
+      {
+        std::unique_lock<std::mutex> file_lock(file->mutex);
+        if (file->pending.empty()) {
+          continue;
+        }
+        chunks.swap(file->pending);
+        file->writing = true;
+      }
+      file->drained.notify_all();
+
+      for (auto &chunk : chunks) {
+        write_chunk(*file, chunk);
+      }
+
+      {
+        std::unique_lock<std::mutex> file_lock(file->mutex);
+        for (auto &chunk : chunks) {
+          if (file->recycled.size() < max_pending) {
+            file->recycled.push_back(std::move(chunk.data));
+          }
+        }
+        file->writing = false;
+      }
+      file->drained.notify_all();
+    }
+
+    lock.lock();
+  }
+}
+
+void output_service_t::write_chunk(file_state_t &file, const chunk_t &chunk) {
+  if (!file.direct) {
+    write_fd(file, chunk.data.get(), chunk.size);
+    return;
+  }
+
+  // Direct writes must be aligned: accumulate data in the staging buffer and
+  // only write out full buffers, keeping the remainder for later.
+  size_t offset = 0;
+  while (offset < chunk.size) {
+    size_t n = std::min(chunk.size - offset, buffer_size - file.staged);
+    memcpy(file.staging + file.staged, chunk.data.get() + offset, n);
+    file.staged += n;
+    offset += n;
+    if (file.staged == buffer_size) {
+      write_staged(file, false);
+    }
+  }
+}
+
+void output_service_t::write_staged(file_state_t &file, bool tail) {
+  size_t aligned = file.staged / direct_io_alignment * direct_io_alignment;
+  if (aligned != 0) {
+    write_fd(file, file.staging, aligned);
+    memmove(file.staging, file.staging + aligned, file.staged - aligned);
+    file.staged -= aligned;
+  }
+
+  // The unaligned tail cannot be written with O_DIRECT. Since it leaves the
+  // file offset unaligned, the file reverts to buffered writes afterwards.
+  if (tail && file.staged != 0) {
+    int flags = fcntl(file.fd, F_GETFL);
+    fcntl(file.fd, F_SETFL, flags & ~O_DIRECT);
+    write_fd(file, file.staging, file.staged);
+    file.staged = 0;
+    file.direct = false;
+  }
+}
+
+void output_service_t::write_fd(file_state_t &file,
+                                const char *data,
+                                size_t size) {
+  while (size != 0) {
+    ssize_t n = ::write(file.fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stderr,
+              "[output] cannot write to %s: %s\n",
+              file.path.c_str(),
+              strerror(errno));
+      abort();
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+output_file_t::output_file_t()
+    : std::ostream(nullptr), service(output_service_t::instance()),
+      buffer(*this) {}
+
+output_file_t::output_file_t(const std::string &path,
+                             std::ios_base::openmode mode)
+    : output_file_t() {
+  open(path, mode);
+}
+
+output_file_t::~output_file_t() { close(); }
+
+void output_file_t::open(const std::string &path,
+                         std::ios_base::openmode mode) {
+  close();
+
+  file = service.open(
+      path, (mode & std::ios_base::app) != 0, [this] { buffer.hand_off(); });
+  if (!file) {
+    setstate(std::ios_base::failbit);
+    return;
+  }
+
+  buffer.reset(std::unique_ptr<char[]>(new char[service.buffer_size]),
+               service.buffer_size);
+  rdbuf(&buffer);
+}
+
+void output_file_t::close() {
+  if (!file)
+    return;
+
+  buffer.hand_off();
+  service.close(file);
+  file.reset();
+  rdbuf(nullptr);
+}
+
+void output_file_t::sync() {
+  if (!file)
+    return;
+
+  buffer.hand_off();
+  service.sync(*file);
+}
+
+void output_file_t::buffer_t::reset(std::unique_ptr<char[]> &&storage,
+                                    size_t capacity) {
+  this->storage = std::move(storage);
+  setp(this->storage.get(), this->storage.get() + capacity);
+  last_hand_off = std::chrono::steady_clock::now();
+}
+
+void output_file_t::buffer_t::hand_off() {
+  size_t size = pptr() - pbase();
+  if (size == 0)
+    return;
+
+  auto &service = parent.service;
+  auto next = service.submit(
+      *parent.file, output_service_t::chunk_t{std::move(storage), size});
+  reset(std::move(next), service.buffer_size);
+}
+
+output_file_t::buffer_t::int_type
+output_file_t::buffer_t::overflow(int_type ch) {
+  hand_off();
+  if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+  }
+  return traits_type::not_eof(ch);
+}
+
+std::streamsize output_file_t::buffer_t::xsputn(const char *s,
+                                                std::streamsize n) {
+  std::streamsize written = 0;
+  while (written < n) {
+    std::streamsize space = epptr() - pptr();
+    if (space == 0) {
+      hand_off();
+      continue;
+    }
+    std::streamsize len = std::min(space, n - written);
+    memcpy(pptr(), s + written, len);
+    pbump(len);
+    written += len;
+  }
+  return n;
+}
+
+int output_file_t::buffer_t::sync() {
+  // Flushes only hand off data periodically: callers flushing after every
+  // line would otherwise produce a write for each of them.
+  auto &service = parent.service;
+  auto now = std::chrono::steady_clock::now();
+  if (!service.async || now - last_hand_off >= service.flush_period) {
+    hand_off();
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+// See LICENSE for license details.
+
+#ifndef __OUTPUT_FILE_H
+#define __OUTPUT_FILE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Process-wide service writing driver output files from a background thread.
+ *
+ * Bridges produce their output on the driver thread, which also drives the
+ * simulation. Writing straight to a file would stall the simulation whenever
+ * the disk (or an NFS mount) is slow. Instead, data written to an
+ * `output_file_t` is accumulated in large per-file buffers that are handed off
+ * to the service, which writes them out from its own thread. The number of
+ * buffers in flight per file is bounded, applying back-pressure to a producer
+ * which consistently outpaces the disk.
+ *
+ * The service is configured through plusargs:
+ *   +output-sync       writes buffers out on the producing thread instead
+ *   +output-direct-io  opens files with O_DIRECT and issues aligned writes
+ *   +output-buffer-size=<bytes> size of the buffers handed off to the writer
+ */
+class output_service_t final {
+public:
+  /**
+   * Returns the unique instance of the service.
+   */
+  static output_service_t &instance();
+
+  ~output_service_t();
+
+  /**
+   * Parses the plusargs controlling the service.
+   *
+   * Must be called before any file is opened.
+   */
+  void configure(const std::vector<std::string> &args);
+
+  /**
+   * Writes out all buffered data of all open files and syncs them to disk.
+   *
+   * Producers must not be writing to the files concurrently.
+   */
+  void sync_all();
+
+  /**
+   * Writes out all buffered data of the files opened by the calling thread
+   * and syncs them to disk. Unlike `sync_all`, this is safe to call while
+   * other threads, such as those of other slots, write to their own files.
+   */
+  void sync_thread();
+
+  /**
+   * Sets the directory against which the relative paths of files opened by
+   * the calling thread are resolved, creating it if needed. Drivers hosting
+   * multiple slots give each slot thread its own directory, so that bridges
+   * opening files with default names do not collide.
+   */
+  static void set_thread_directory(const std::string &dir);
+
+  /**
+   * Resolves a relative path against the directory of the calling thread.
+   * Output not written through `output_file_t` (sockets, snapshots) must be
+   * placed with it to be kept apart across slots.
+   */
+  static std::string resolve_path(const std::string &path);
+
+private:
+  output_service_t() = default;
+
+  /**
+   * Buffer of data handed off by a producer.
+   */
+  struct chunk_t {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+
+  /**
+   * State of a file shared between the producer and the writer thread.
+   */
+  struct file_state_t {
+    int fd = -1;
+    std::string path;
+    bool direct = false;
+    /// Thread which opened the file and produces its data.
+    std::thread::id owner;
+
+    std::mutex mutex;
+    std::condition_variable drained;
+    /// Buffers waiting to be written out.
+    std::deque<chunk_t> pending;
+    /// Written buffers which can be recycled by the producer.
+    std::vector<std::unique_ptr<char[]>> recycled;
+    /// Set while the writer thread is writing buffers of this file.
+    bool writing = false;
+
+    /// Page-aligned staging area for O_DIRECT writes.
+    char *staging = nullptr;
+    size_t staged = 0;
+
+    /// Callback handing off the data buffered by the producer.
+    std::function<void()> flush_producer;
+  };
+
+  friend class output_file_t;
+
+  std::shared_ptr<file_state_t>
+  open(const std::string &path, bool append, std::function<void()> &&flush);
+  void close(const std::shared_ptr<file_state_t> &file);
+
+  /**
+   * Hands off a full buffer, returning an empty one for the producer to fill.
+   */
+  std::unique_ptr<char[]> submit(file_state_t &file, chunk_t &&chunk);
+
+  /**
+   * Blocks until all data submitted to a file is written, then syncs it.
+   */
+  void sync(file_state_t &file);
+
+  void write_chunk(file_state_t &file, const chunk_t &chunk);
+  void write_staged(file_state_t &file, bool tail);
+  void write_fd(file_state_t &file, const char *data, size_t size);
+  void writer_loop();
+
+  bool async = true;
+  bool direct = false;
+  size_t buffer_size = 1 << 20;
+  /// Maximum number of buffers of a single file waiting to be written.
+  size_t max_pending = 8;
+  /// Maximum time data can stay buffered in the producer after a flush.
+  std::chrono::milliseconds flush_period{100};
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<std::shared_ptr<file_state_t>> files;
+  bool work = false;
+  bool stop = false;
+  std::thread thread;
+};
+
+/**
+ * Output stream backed by the asynchronous output service.
+ *
+ * The class is a drop-in replacement for `std::ofstream` in bridges: it is
+ * opened and closed similarly and supports all stream operations. Flushes of
+ * the stream (ex. `std::endl`) do not synchronously write to the file: they
+ * only hand off buffered data if it has been held for longer than the
+ * service's flush period. `sync` is provided to force all data to disk.
+ */
+class output_file_t final : public std::ostream {
+public:
+  output_file_t();
+  explicit output_file_t(const std::string &path,
+                         std::ios_base::openmode mode = std::ios_base::out);
+  ~output_file_t() override;
+
+  void open(const std::string &path,
+            std::ios_base::openmode mode = std::ios_base::out);
+  bool is_open() const { return file != nullptr; }
+  void close();
+
+  /**
+   * Writes out all data written to the stream so far and syncs the file.
+   */
+  void sync();
+
+private:
+  class buffer_t final : public std::streambuf {
+  public:
+    buffer_t(output_file_t &parent) : parent(parent) {}
+
+    void reset(std::unique_ptr<char[]> &&storage, size_t capacity);
+    void hand_off();
+
+  protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+  private:
+    output_file_t &parent;
+    std::unique_ptr<char[]> storage;
+    std::chrono::steady_clock::time_point last_hand_off;
+  };
+
+  /// Referencing the service on construction ensures that it outlives files.
+  output_service_t &service;
+  buffer_t buffer;
+  std::shared_ptr<output_service_t::file_state_t> file;
+};
+
+#endif // __OUTPUT_FILE_H
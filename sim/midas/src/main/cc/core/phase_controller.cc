@@ -0,0 +1,143 @@
+// See LICENSE for license details.
+
+#include "phase_controller.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "bridges/autocounter.h"
+#include "bridges/synthesized_prints.h"
+#include "core/widget_registry.h"
+
+/**
+ * Parses a detailed phase written as <start>:<end>, where the end can be
+ * omitted. `origin` names the argument or file the phase comes from.
+ */
+static std::pair<uint64_t, uint64_t> parse_window(const std::string &spec,
+                                                  const std::string &origin) {
+  const char *str = spec.c_str();
+  char *sep;
+  uint64_t start = strtoull(str, &sep, 0);
+  uint64_t end = UINT64_MAX;
+  if (sep == str || *sep != ':') {
+    fprintf(stderr, "Malformed phase in %s: %s\n", origin.c_str(), str);
+    abort();
+  }
+  if (sep[1] != '\0') {
+    char *tail;
+    end = strtoull(sep + 1, &tail, 0);
+    if (*tail != '\0') {
+      fprintf(stderr, "Malformed phase in %s: %s\n", origin.c_str(), str);
+      abort();
+    }
+  }
+  return {start, end};
+}
+
+std::unique_ptr<phase_controller_t>
+phase_controller_t::from_args(const std::vector<std::string> &args) {
+  std::string detail_arg = std::string("+phase-detail=");
+  std::string file_arg = std::string("+phase-file=");
+  std::string trigger_arg = std::string("+phase-trigger-print=");
+  std::string trigger_cycles_arg = std::string("+phase-trigger-cycles=");
+
+  auto phases = std::make_unique<phase_controller_t>();
+  bool enabled = false;
+  for (auto &arg : args) {
+    if (arg.find(detail_arg) == 0) {
+      phases->windows.push_back(
+          parse_window(arg.substr(detail_arg.length()), detail_arg));
+      enabled = true;
+    }
+    if (arg.find(file_arg) == 0) {
+      const std::string path = arg.substr(file_arg.length());
+      std::ifstream file(path);
+      if (!file.is_open()) {
+        fprintf(stderr, "Cannot open phase file: %s\n", path.c_str());
+        abort();
+      }
+      std::string line;
+      while (std::getline(file, line)) {
+        // Skip blank lines and comments.
+        auto start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') {
+          continue;
+        }
+        auto end = line.find_last_not_of(" \t\r");
+        phases->windows.push_back(
+            parse_window(line.substr(start, end - start + 1), path));
+      }
+      enabled = true;
+    }
+    if (arg.find(trigger_arg) == 0) {
+      phases->marker = arg.substr(trigger_arg.length());
+      enabled = true;
+    }
+    if (arg.find(trigger_cycles_arg) == 0) {
+      phases->trigger_cycles =
+          strtoull(arg.c_str() + trigger_cycles_arg.length(), nullptr, 0);
+    }
+  }
+  if (!enabled) {
+    return nullptr;
+  }
+
+  // Scheduled phases must be non-empty and disjoint. Triggered phases are
+  // added while the simulation runs and may overlap scheduled ones.
+  auto &windows = phases->windows;
+  std::sort(windows.begin(), windows.end());
+  for (size_t i = 0; i < windows.size(); i++) {
+    auto [start, end] = windows[i];
+    if (start >= end) {
+      fprintf(stderr,
+              "Phase %" PRIu64 ":%" PRIu64 " does not end after it starts\n",
+              start,
+              end);
+      abort();
+    }
+    if (i > 0 && start < windows[i - 1].second) {
+      fprintf(stderr,
+              "Phases %" PRIu64 ":%" PRIu64 " and %" PRIu64 ":%" PRIu64
+              " overlap\n",
+              windows[i - 1].first,
+              windows[i - 1].second,
+              start,
+              end);
+      abort();
+    }
+  }
+  return phases;
+}
+
+void phase_controller_t::attach(widget_registry_t &registry) {
+  for (auto *prints : registry.get_bridges<synthesized_prints_t>()) {
+    prints->set_phases(*this);
+  }
+  for (auto *autocounter : registry.get_bridges<autocounter_t>()) {
+    autocounter->set_phases(*this);
+  }
+}
+
+void phase_controller_t::trigger(uint64_t cycle) {
+  const uint64_t end = trigger_cycles > UINT64_MAX - cycle
+                           ? UINT64_MAX
+                           : cycle + trigger_cycles;
+  windows.emplace_back(cycle, end);
+  fprintf(stderr, "Detailed phase triggered at cycle %" PRIu64 "\n", cycle);
+}
+
+std::pair<uint64_t, uint64_t> phase_controller_t::detailed_bounds() const {
+  if (!marker.empty()) {
+    // Triggers can fire at any point of the simulation.
+    return {0, UINT64_MAX};
+  }
+  uint64_t lo = UINT64_MAX, hi = 0;
+  for (auto &[start, end] : windows) {
+    lo = std::min(lo, start);
+    hi = std::max(hi, end);
+  }
+  return {lo, hi};
+}
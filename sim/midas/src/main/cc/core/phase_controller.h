@@ -0,0 +1,89 @@
+// See LICENSE for license details.
+
+#ifndef __PHASE_CONTROLLER_H
+#define __PHASE_CONTROLLER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class widget_registry_t;
+
+/**
+ * Splits a simulation into fast-forward and detailed phases.
+ *
+ * Instrumentation (prints, autocounters and FASED profiling) only records
+ * data during detailed phases. Fast-forward phases skip all the work of
+ * formatting, reading counters and writing output, letting long simulations
+ * reach their regions of interest at full speed.
+ *
+ * Phases are scheduled through plusargs, with cycles in base clock cycles:
+ *   +phase-detail=<start>:<end>  detailed phase over [start, end); the end can
+ *                                be omitted to stay detailed until the end.
+ *                                Can be passed multiple times.
+ *   +phase-file=<path>           detailed phases listed in a file, one
+ *                                <start>:<end> per line. Blank lines and
+ *                                lines starting with '#' are skipped.
+ *   +phase-trigger-print=<text>  starts a detailed phase on the cycle a print
+ *                                whose format string contains <text> fires.
+ *   +phase-trigger-cycles=<n>    length of triggered phases, unbounded by
+ *                                default.
+ *
+ * Scheduled phases must not be empty or overlap. Without any of these, the
+ * controller is not created and instrumentation is always enabled. Bridges
+ * query the phase of the cycles they are processing, so phase boundaries are
+ * exact regardless of how far the target runs ahead of the driver.
+ */
+class phase_controller_t final {
+public:
+  /**
+   * Creates the controller if the plusargs schedule any phases.
+   */
+  static std::unique_ptr<phase_controller_t>
+  from_args(const std::vector<std::string> &args);
+
+  /**
+   * Hands the controller over to all instrumentation bridges. Must be called
+   * before the bridges are initialised.
+   */
+  void attach(widget_registry_t &registry);
+
+  /**
+   * Returns true if the given base clock cycle falls in a detailed phase.
+   */
+  bool detailed(uint64_t cycle) const {
+    for (auto &[start, end] : windows) {
+      if (start <= cycle && cycle < end) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Starts a detailed phase at the given cycle.
+   */
+  void trigger(uint64_t cycle);
+
+  /**
+   * Returns the marker of triggering prints, empty if triggers are disabled.
+   */
+  const std::string &trigger_marker() const { return marker; }
+
+  /**
+   * Returns the range of cycles outside of which no phase can be detailed.
+   */
+  std::pair<uint64_t, uint64_t> detailed_bounds() const;
+
+private:
+  /// Detailed phases, as half-open intervals of base clock cycles.
+  std::vector<std::pair<uint64_t, uint64_t>> windows;
+  /// Format string fragment identifying triggering prints.
+  std::string marker;
+  /// Length of triggered phases.
+  uint64_t trigger_cycles = UINT64_MAX;
+};
+
+#endif // __PHASE_CONTROLLER_H
@@ -5,6 +5,7 @@
 #include "core/simulation.h"
 
 #include <iostream>
+#include <thread>
 
 simif_t::simif_t(const TargetConfig &config) : config(config) {}
 
@@ -20,6 +21,26 @@ FPGAManagedStreamIO &simif_t::get_fpga_managed_stream_io() {
   abort();
 }
 
+void simif_t::issue(mmio_batch_t &batch) {
+  for (auto &access : batch.accesses) {
+    if (access.dest) {
+      *access.dest = read(access.addr);
+    } else {
+      write(access.addr, access.data);
+    }
+  }
+}
+
+void simif_t::host_delay(std::chrono::nanoseconds delay) {
+  // Sleeping has a granularity of tens of microseconds: only yield the core
+  // if the delay is shorter than that.
+  if (delay < std::chrono::microseconds(50)) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(delay);
+  }
+}
+
 std::string_view simif_t::get_target_name() const { return config.target_name; }
 
 int simif_t::run(simulation_t &sim) { return sim.execute_simulation_flow(); }
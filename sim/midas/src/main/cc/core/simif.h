@@ -4,6 +4,7 @@
 #define __SIMIF_H
 
 #include <cassert>
+#include <chrono>
 #include <cstring>
 
 #include <memory>
@@ -12,6 +13,7 @@
 #include <sstream>
 
 #include <map>
+#include <vector>
 
 #include "core/timing.h"
 #include "core/widget_registry.h"
@@ -22,6 +24,37 @@ class CPUManagedStreamIO;
 class FPGAManagedStreamIO;
 class TargetConfig;
 
+/**
+ * Sequence of MMIO accesses to be issued together.
+ *
+ * Accesses are performed in order. The values of reads are stored to the
+ * locations provided when the batch is built, once the batch is issued.
+ *
+ * Batching only groups the accesses: no platform currently overrides
+ * `simif_t::issue`, so they are still issued one round trip at a time.
+ */
+class mmio_batch_t final {
+public:
+  struct access_t {
+    size_t addr;
+    uint32_t data;
+    /// Destination of the value of a read, null for writes.
+    uint32_t *dest;
+  };
+
+  void write(size_t addr, uint32_t data) {
+    accesses.push_back({addr, data, nullptr});
+  }
+
+  void read(size_t addr, uint32_t *dest) {
+    accesses.push_back({addr, 0, dest});
+  }
+
+  void clear() { accesses.clear(); }
+
+  std::vector<access_t> accesses;
+};
+
 /**
  * FireSim's main simulation class.
  *
@@ -54,6 +87,49 @@ public:
    */
   virtual uint32_t read(size_t addr) = 0;
 
+  /**
+   * @brief Issues a batch of MMIO accesses.
+   *
+   * The default implementation performs the accesses one by one. Platforms
+   * which can overlap the round trips of independent accesses should override
+   * it, preserving the order of writes relative to subsequent reads.
+   */
+  virtual void issue(mmio_batch_t &batch);
+
+  /**
+   * @brief Writes directly into the DRAM attached to the FPGA.
+   *
+   * Platforms with a path to DRAM which is faster than the loadmem widget
+   * (ex. DMA) can implement this method. The default implementation returns
+   * false, in which case the caller must fall back to MMIO.
+   *
+   * @returns True if the data was written.
+   */
+  virtual bool write_dram(uint64_t addr, const uint8_t *data, size_t size) {
+    return false;
+  }
+
+  /**
+   * @brief Reads directly from the DRAM attached to the FPGA.
+   *
+   * Counterpart of `write_dram`.
+   *
+   * @returns True if the data was read.
+   */
+  virtual bool read_dram(uint64_t addr, uint8_t *data, size_t size) {
+    return false;
+  }
+
+  /**
+   * @brief Lets the host idle while waiting on the FPGA.
+   *
+   * Called by pollers between reads of a status register. The default
+   * implementation yields the host thread for short delays and sleeps for
+   * longer ones. Platforms where the FPGA only makes progress while the
+   * driver interacts with it can override this method.
+   */
+  virtual void host_delay(std::chrono::nanoseconds delay);
+
   /**
    * Return a functor accessing CPU-managed streams.
    *
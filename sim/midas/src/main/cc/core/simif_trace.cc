@@ -0,0 +1,96 @@
+// See LICENSE for license details.
+
+#include "simif_trace.h"
+
+#include "core/config.h"
+#include "core/stream_engine.h"
+
+simif_trace_t::simif_trace_t(const TargetConfig &config,
+                             simif_t *platform,
+                             std::unique_ptr<host_trace_t> &&trace)
+    : simif_t(config), platform(platform), trace(std::move(trace)) {
+  assert(!platform == this->trace->replaying());
+}
+
+void simif_trace_t::attach(widget_registry_t &registry) {
+  // Streams are identified in the trace by their engine and their index.
+  if (auto *streams = registry.get_stream_engine()) {
+    streams->set_trace(trace.get(), 0);
+  }
+  if (auto *streams = registry.get_fpga_stream_engine()) {
+    streams->set_trace(trace.get(), 1);
+  }
+}
+
+void simif_trace_t::write(size_t addr, uint32_t data) {
+  trace->write(addr, data, [&] { platform->write(addr, data); });
+}
+
+uint32_t simif_trace_t::read(size_t addr) {
+  return trace->read(addr, [&] { return platform->read(addr); });
+}
+
+void simif_trace_t::issue(mmio_batch_t &batch) {
+  if (trace->replaying()) {
+    return simif_t::issue(batch);
+  }
+  // Let the platform overlap the accesses, recording them once it is done.
+  platform->issue(batch);
+  for (auto &access : batch.accesses) {
+    if (access.dest) {
+      trace->read(access.addr, [&] { return *access.dest; });
+    } else {
+      trace->write(access.addr, access.data, [] {});
+    }
+  }
+}
+
+bool simif_trace_t::write_dram(uint64_t addr,
+                               const uint8_t *data,
+                               size_t size) {
+  return trace->write_dram(
+      addr, size, [&] { return platform->write_dram(addr, data, size); });
+}
+
+bool simif_trace_t::read_dram(uint64_t addr, uint8_t *data, size_t size) {
+  return trace->read_dram(
+      addr, data, size, [&] { return platform->read_dram(addr, data, size); });
+}
+
+void simif_trace_t::host_delay(std::chrono::nanoseconds delay) {
+  // Replay runs at full speed.
+  if (platform) {
+    platform->host_delay(delay);
+  }
+}
+
+int simif_trace_t::run(simulation_t &sim) {
+  return platform ? platform->run(sim) : simif_t::run(sim);
+}
+
+size_t simif_trace_t::cpu_managed_axi4_write(size_t addr,
+                                             const char *data,
+                                             size_t size) {
+  assert(platform && "stream accesses are replayed by the stream engine");
+  return platform->get_cpu_managed_stream_io().cpu_managed_axi4_write(
+      addr, data, size);
+}
+
+size_t
+simif_trace_t::cpu_managed_axi4_read(size_t addr, char *data, size_t size) {
+  assert(platform && "stream accesses are replayed by the stream engine");
+  return platform->get_cpu_managed_stream_io().cpu_managed_axi4_read(
+      addr, data, size);
+}
+
+uint64_t simif_trace_t::get_beat_bytes() const {
+  if (platform) {
+    return platform->get_cpu_managed_stream_io().get_beat_bytes();
+  }
+  return config.cpu_managed ? config.cpu_managed->beat_bytes() : 64;
+}
+
+char *simif_trace_t::get_memory_base() {
+  return platform ? platform->get_fpga_managed_stream_io().get_memory_base()
+                  : nullptr;
+}
@@ -0,0 +1,65 @@
+// See LICENSE for license details.
+
+#ifndef __SIMIF_TRACE_H
+#define __SIMIF_TRACE_H
+
+#include <memory>
+
+#include "bridges/fpga_managed_stream.h"
+#include "core/host_trace.h"
+#include "core/simif.h"
+
+/**
+ * Platform interface recording or replaying the traffic of another one.
+ *
+ * While recording, all accesses are forwarded to the platform and logged to
+ * the trace. While replaying, there is no platform: responses are served from
+ * the trace. Streams are traced at the level of the stream engines, once
+ * `attach` hands them the trace. See `host_trace_t`.
+ */
+class simif_trace_t final : public simif_t,
+                            public BiDirectionalManagedStreamIO {
+public:
+  /**
+   * Wraps a platform interface, which must be null when replaying.
+   */
+  simif_trace_t(const TargetConfig &config,
+                simif_t *platform,
+                std::unique_ptr<host_trace_t> &&trace);
+
+  /**
+   * Hands the trace over to the stream engines. Must be called before the
+   * stream engines are initialised.
+   */
+  void attach(widget_registry_t &registry);
+
+  void write(size_t addr, uint32_t data) override;
+  uint32_t read(size_t addr) override;
+  void issue(mmio_batch_t &batch) override;
+
+  bool write_dram(uint64_t addr, const uint8_t *data, size_t size) override;
+  bool read_dram(uint64_t addr, uint8_t *data, size_t size) override;
+
+  void host_delay(std::chrono::nanoseconds delay) override;
+
+  CPUManagedStreamIO &get_cpu_managed_stream_io() override { return *this; }
+  FPGAManagedStreamIO &get_fpga_managed_stream_io() override { return *this; }
+
+  int run(simulation_t &sim) override;
+
+private:
+  uint32_t mmio_read(size_t addr) override { return read(addr); }
+  void mmio_write(size_t addr, uint32_t value) override {
+    return write(addr, value);
+  }
+  size_t
+  cpu_managed_axi4_write(size_t addr, const char *data, size_t size) override;
+  size_t cpu_managed_axi4_read(size_t addr, char *data, size_t size) override;
+  uint64_t get_beat_bytes() const override;
+  char *get_memory_base() override;
+
+  simif_t *platform;
+  std::unique_ptr<host_trace_t> trace;
+};
+
+#endif // __SIMIF_TRACE_H
@@ -4,11 +4,14 @@
 #include "bridges/clock.h"
 #include "bridges/loadmem.h"
 #include "bridges/master.h"
+#include "bridges/peek_poke.h"
 #include "core/bridge_driver.h"
+#include "core/output_file.h"
 #include "core/simif.h"
 #include "core/stream_engine.h"
 #include "core/timing.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
 #include <cstdio>
@@ -27,6 +30,12 @@ simulation_t::simulation_t(widget_registry_t &registry,
     if (arg.find("+zero-out-dram") == 0) {
       do_zero_out_dram = true;
     }
+    if (arg.find("+dram-snapshot=") == 0) {
+      dram_snapshot_path = output_service_t::resolve_path(arg.c_str() + 15);
+    }
+    if (arg.find("+dram-snapshot-size=") == 0) {
+      dram_snapshot_size = strtoull(arg.c_str() + 20, nullptr, 0);
+    }
     if (arg.find("+check-fingerprint") == 0) {
       check_fingerprint_only = true;
     }
@@ -37,6 +46,24 @@ simulation_t::simulation_t(widget_registry_t &registry,
 
   if (fastloadmem)
     load_mem_path.clear();
+
+  // Targets write past the extent of the loaded image while booting, and
+  // reading a whole channel back over MMIO takes hours: the extent of the
+  // snapshot must be chosen explicitly.
+  if (!dram_snapshot_path.empty() && !dram_snapshot_size) {
+    fprintf(stderr,
+            "+dram-snapshot requires +dram-snapshot-size=<bytes>, covering "
+            "all memory written by the target\n");
+    exit(EXIT_FAILURE);
+  }
+
+  telemetry = telemetry_t::from_args(registry, clock, args);
+  fmr_profile = fmr_profile_t::from_args(registry, clock, args);
+
+  phases = phase_controller_t::from_args(args);
+  if (phases) {
+    phases->attach(registry);
+  }
 }
 
 void simulation_t::record_start_times() {
@@ -46,8 +73,12 @@ void simulation_t::record_start_times() {
 
 void simulation_t::record_end_times() {
   end_time = timestamp();
-  end_tcycle = clock.tcycle();
-  end_hcycle = clock.hcycle();
+  clock.sample();
+  end_tcycle = clock.cached_tcycle();
+  end_hcycle = clock.cached_hcycle();
+  if (fmr_profile) {
+    fmr_profile->finish();
+  }
 }
 
 void simulation_t::print_simulation_performance_summary() {
@@ -85,6 +116,10 @@ void simulation_t::print_simulation_performance_summary() {
   fprintf(stderr,
           "Note: The latter three figures are based on the fastest "
           "target clock.\n");
+
+  if (fmr_profile) {
+    fmr_profile->print_summary();
+  }
 }
 
 void simulation_t::simulation_init() {
@@ -126,6 +161,10 @@ int simulation_t::execute_simulation_flow() {
     }
   }
 
+  // DRAM is zeroed out by the FPGA and the memory image is read on a helper
+  // thread while streams are set up.
+  start_init_dram();
+
   if (auto *fpga_stream = registry.get_fpga_stream_engine()) {
     fpga_stream->init();
   }
@@ -134,7 +173,9 @@ int simulation_t::execute_simulation_flow() {
     stream->init();
   }
 
-  init_dram();
+  // DRAM must be fully initialised before bridges are, since their
+  // initialisation releases the target.
+  finish_init_dram();
 
   simulation_init();
 
@@ -144,7 +185,12 @@ int simulation_t::execute_simulation_flow() {
   fprintf(stderr, "\nSimulation complete.\n");
   record_end_times();
 
+  if (!dram_snapshot_path.empty()) {
+    save_dram_snapshot();
+  }
+
   simulation_finish();
+  output_service_t::instance().sync_thread();
 
   const bool timeout = simulation_timed_out();
 
@@ -166,22 +212,68 @@ int simulation_t::execute_simulation_flow() {
   return timeout ? EXIT_FAILURE : exit_code;
 }
 
+void simulation_t::save_dram_snapshot() {
+  auto *loadmem = registry.get_widget_opt<loadmem_t>();
+  if (!loadmem) {
+    fprintf(stderr, "Skipping DRAM snapshot: target does not use DRAM\n");
+    return;
+  }
+
+  const size_t size =
+      std::min<size_t>(*dram_snapshot_size, loadmem->get_channel_size());
+
+  if (!pause_target()) {
+    fprintf(stderr, "Skipping DRAM snapshot: cannot pause the target\n");
+    return;
+  }
+
+  fprintf(stderr, "Saving DRAM to %s\n", dram_snapshot_path.c_str());
+  loadmem->read_dram_image(size).save(dram_snapshot_path);
+}
+
+bool simulation_t::pause_target() {
+  auto *peek_poke = registry.get_widget_opt<peek_poke_t>();
+  if (!peek_poke) {
+    return false;
+  }
+  // Let the last step complete, serving bridges until the target stops.
+  while (!peek_poke->is_done()) {
+    clock.next_iteration();
+    for (auto *bridge : registry.get_all_bridges()) {
+      tick_bridge(*bridge);
+    }
+  }
+  return true;
+}
+
 void simulation_t::wait_for_init() {
   auto &master = registry.get_widget<master_t>();
   while (!master.is_init_done())
     ;
 }
 
-void simulation_t::init_dram() {
+void simulation_t::start_init_dram() {
+  auto *loadmem = registry.get_widget_opt<loadmem_t>();
+  if (loadmem && do_zero_out_dram) {
+    fprintf(stderr, "Zeroing out FPGA DRAM. This will take a few seconds...\n");
+    loadmem->start_zero_out_dram();
+  }
+  if (loadmem && !load_mem_path.empty()) {
+    pending_mem_image = std::async(std::launch::async, [=, this] {
+      return loadmem->read_mem_image(load_mem_path);
+    });
+  }
+}
+
+void simulation_t::finish_init_dram() {
   if (auto *loadmem = registry.get_widget_opt<loadmem_t>()) {
     if (do_zero_out_dram) {
-      fprintf(stderr,
-              "Zeroing out FPGA DRAM. This will take a few seconds...\n");
-      loadmem->zero_out_dram();
+      loadmem->wait_zero_out_dram();
     }
 
-    if (!load_mem_path.empty()) {
-      loadmem->load_mem_from_file(load_mem_path);
+    if (pending_mem_image.valid()) {
+      mem_image = pending_mem_image.get();
+      loadmem->write_mem_image(*mem_image);
     }
   } else {
     if (do_zero_out_dram || !load_mem_path.empty()) {
@@ -190,3 +282,12 @@ void simulation_t::init_dram() {
     }
   }
 }
+
+void simulation_t::reinit_dram() {
+  if (auto *loadmem = registry.get_widget_opt<loadmem_t>()) {
+    loadmem->zero_out_dram();
+    if (mem_image) {
+      loadmem->write_mem_image(*mem_image);
+    }
+  }
+}
@@ -3,10 +3,16 @@
 #ifndef __SIMULATION_H
 #define __SIMULATION_H
 
+#include <future>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "core/fmr_profile.h"
+#include "core/memory_image.h"
+#include "core/phase_controller.h"
+#include "core/telemetry.h"
 #include "core/timing.h"
 
 class simif_t;
@@ -94,9 +100,39 @@ private:
   void wait_for_init();
 
   /**
-   * Initialises the memory system of the simulation.
+   * Starts zeroing out DRAM if requested and reading the image to load into
+   * it on a helper thread. Until `finish_init_dram` returns, only widgets
+   * other than the loadmem widget can be accessed.
    */
-  void init_dram();
+  void start_init_dram();
+
+  /**
+   * Waits for DRAM to be zeroed out, then writes the image to it. DRAM is
+   * fully initialised on return, before bridges release the target.
+   */
+  void finish_init_dram();
+
+  /**
+   * Saves the contents of DRAM to the snapshot file, once the target is
+   * paused.
+   */
+  void save_dram_snapshot();
+
+  /**
+   * Waits for the target to stop at the end of its current step, ticking
+   * bridges meanwhile.
+   *
+   * @returns False if the target cannot be paused.
+   */
+  bool pause_target();
+
+  void tick_bridge_sampled(bridge_driver_t &bridge) {
+    if (telemetry) {
+      telemetry->tick_bridge(bridge);
+    } else {
+      bridge.tick();
+    }
+  }
 
   // Simulation performance counters.
   void record_start_times();
@@ -104,11 +140,35 @@ private:
   void print_simulation_performance_summary();
 
 protected:
+  /**
+   * Zeroes out DRAM and writes the memory image to it again, restoring the
+   * memory of a target that is run multiple times. The target must be paused.
+   */
+  void reinit_dram();
+
+  /**
+   * Ticks a bridge from the simulation main loop, measuring the cost of the
+   * tick if telemetry or the FMR profile are enabled.
+   */
+  void tick_bridge(bridge_driver_t &bridge) {
+    if (fmr_profile) {
+      fmr_profile->tick_bridge(bridge, [&] { tick_bridge_sampled(bridge); });
+    } else {
+      tick_bridge_sampled(bridge);
+    }
+  }
+
   /**
    * Widget registry.
    */
   widget_registry_t &registry;
 
+  /**
+   * Schedule of detailed phases, if requested through plusargs. Drivers
+   * should only run instrumentation in detailed phases.
+   */
+  std::unique_ptr<phase_controller_t> phases;
+
 private:
   /**
    * Name of the simulated target.
@@ -130,6 +190,28 @@ private:
    */
   bool do_zero_out_dram = false;
 
+  /**
+   * If set, DRAM is saved to this file once the simulation completes. The
+   * snapshot can be restored by passing it to +loadmem.
+   */
+  std::string dram_snapshot_path;
+
+  /**
+   * Number of bytes of DRAM saved to snapshots, which must be set along with
+   * the snapshot path.
+   */
+  std::optional<size_t> dram_snapshot_size;
+
+  /**
+   * Image read in the background by `start_init_dram`.
+   */
+  std::future<std::shared_ptr<const memory_image_t>> pending_mem_image;
+
+  /**
+   * Image written to DRAM, kept to restore DRAM in `reinit_dram`.
+   */
+  std::shared_ptr<const memory_image_t> mem_image;
+
   /**
    * If set, read the presence register, check it, and exit the simulation
    * cleanly
@@ -146,6 +228,16 @@ private:
   std::optional<uint64_t> start_hcycle;
   std::optional<uint64_t> end_hcycle;
   uint64_t end_tcycle = 0;
+
+  /**
+   * Live telemetry server, if requested through +telemetry-socket.
+   */
+  std::unique_ptr<telemetry_t> telemetry;
+
+  /**
+   * FMR profiler, if requested through +fmr-profile.
+   */
+  std::unique_ptr<fmr_profile_t> fmr_profile;
 };
 
 #endif // __SIMULATION_H
@@ -3,7 +3,11 @@
 #include <cassert>
 #include <stdio.h>
 
+#include "core/host_trace.h"
+
 void StreamEngine::init() {
+  pulled_bytes.resize(fpga_to_cpu_streams.size());
+  pushed_bytes.resize(cpu_to_fpga_streams.size());
   for (auto &stream : this->fpga_to_cpu_streams) {
     stream->init();
   }
@@ -17,8 +21,13 @@ size_t StreamEngine::pull(unsigned stream,
                           size_t num_bytes,
                           size_t required_bytes) {
   assert(stream < fpga_to_cpu_streams.size());
-  return this->fpga_to_cpu_streams[stream]->pull(
-      dest, num_bytes, required_bytes);
+  auto &driver = *this->fpga_to_cpu_streams[stream];
+  auto pull = [&] { return driver.pull(dest, num_bytes, required_bytes); };
+  const size_t bytes =
+      trace ? trace->pull(trace_key(true, stream), dest, num_bytes, pull)
+            : pull();
+  pulled_bytes[stream] += bytes;
+  return bytes;
 }
 
 size_t StreamEngine::push(unsigned stream,
@@ -26,16 +35,28 @@ size_t StreamEngine::push(unsigned stream,
                           size_t num_bytes,
                           size_t required_bytes) {
   assert(stream < cpu_to_fpga_streams.size());
-  return this->cpu_to_fpga_streams[stream]->push(
-      src, num_bytes, required_bytes);
+  auto &driver = *this->cpu_to_fpga_streams[stream];
+  auto push = [&] { return driver.push(src, num_bytes, required_bytes); };
+  const size_t bytes =
+      trace ? trace->push(trace_key(false, stream), num_bytes, push) : push();
+  pushed_bytes[stream] += bytes;
+  return bytes;
 }
 
 void StreamEngine::pull_flush(unsigned stream) {
   assert(stream < fpga_to_cpu_streams.size());
-  return this->fpga_to_cpu_streams[stream]->flush();
+  auto &driver = *this->fpga_to_cpu_streams[stream];
+  if (trace) {
+    return trace->flush(trace_key(true, stream), [&] { driver.flush(); });
+  }
+  return driver.flush();
 }
 
 void StreamEngine::push_flush(unsigned stream) {
   assert(stream < cpu_to_fpga_streams.size());
-  return this->cpu_to_fpga_streams[stream]->flush();
+  auto &driver = *this->cpu_to_fpga_streams[stream];
+  if (trace) {
+    return trace->flush(trace_key(false, stream), [&] { driver.flush(); });
+  }
+  return driver.flush();
 }
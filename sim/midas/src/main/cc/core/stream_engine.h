@@ -3,9 +3,12 @@
 #ifndef __BRIDGES_BRIDGE_STREAM_DRIVER_H
 #define __BRIDGES_BRIDGE_STREAM_DRIVER_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+class host_trace_t;
+
 class FPGAToCPUStreamDriver {
 public:
   virtual ~FPGAToCPUStreamDriver() = default;
@@ -93,9 +96,48 @@ public:
   int cpu_to_fpga_cnt() { return cpu_to_fpga_streams.size(); }
   int fpga_to_cpu_cnt() { return fpga_to_cpu_streams.size(); }
 
+  /**
+   * @brief Returns the number of bytes pulled from an FPGA-to-CPU stream.
+   */
+  uint64_t get_pulled_bytes(unsigned int stream) const {
+    return pulled_bytes[stream];
+  }
+
+  /**
+   * @brief Returns the number of bytes pushed to a CPU-to-FPGA stream.
+   */
+  uint64_t get_pushed_bytes(unsigned int stream) const {
+    return pushed_bytes[stream];
+  }
+
+  /**
+   * @brief Records stream transfers to a trace, or replays them from it.
+   *
+   * @param trace The trace, null to disable tracing.
+   * @param engine Index identifying the engine in the trace.
+   */
+  void set_trace(host_trace_t *trace, unsigned engine) {
+    this->trace = trace;
+    trace_engine = engine;
+  }
+
 protected:
   std::vector<std::unique_ptr<FPGAToCPUStreamDriver>> fpga_to_cpu_streams;
   std::vector<std::unique_ptr<CPUToFPGAStreamDriver>> cpu_to_fpga_streams;
+
+private:
+  /**
+   * Returns the key identifying a stream in the trace.
+   */
+  uint32_t trace_key(bool to_cpu, unsigned stream) const {
+    return (trace_engine << 17) | (to_cpu << 16) | stream;
+  }
+
+  std::vector<uint64_t> pulled_bytes;
+  std::vector<uint64_t> pushed_bytes;
+
+  host_trace_t *trace = nullptr;
+  unsigned trace_engine = 0;
 };
 
 #endif // __BRIDGES_BRIDGE_STREAM_DRIVER_H
@@ -0,0 +1,217 @@
+// See LICENSE for license details.
+
+#include "telemetry.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bridges/clock.h"
+#include "core/output_file.h"
+#include "core/stream_engine.h"
+#include "core/widget_registry.h"
+
+/**
+ * Invokes `f(engine, direction, index, bytes)` on all streams, in a stable
+ * order.
+ */
+template <typename F>
+static void for_each_stream(widget_registry_t &registry, F f) {
+  auto visit = [&](const char *engine, StreamEngine *streams) {
+    if (!streams) {
+      return;
+    }
+    for (int i = 0; i < streams->fpga_to_cpu_cnt(); i++) {
+      f(engine, "to_cpu", i, streams->get_pulled_bytes(i));
+    }
+    for (int i = 0; i < streams->cpu_to_fpga_cnt(); i++) {
+      f(engine, "to_fpga", i, streams->get_pushed_bytes(i));
+    }
+  };
+  visit("cpu_managed", registry.get_stream_engine());
+  visit("fpga_managed", registry.get_fpga_stream_engine());
+}
+
+std::unique_ptr<telemetry_t>
+telemetry_t::from_args(widget_registry_t &registry,
+                       clockmodule_t &clock,
+                       const std::vector<std::string> &args) {
+  std::string socket_arg = std::string("+telemetry-socket=");
+  std::string interval_arg = std::string("+telemetry-interval-ms=");
+
+  std::string socket_path;
+  std::chrono::milliseconds interval(1000);
+  for (auto &arg : args) {
+    if (arg.find(socket_arg) == 0) {
+      socket_path =
+          output_service_t::resolve_path(arg.substr(socket_arg.length()));
+    }
+    if (arg.find(interval_arg) == 0) {
+      interval = std::chrono::milliseconds(
+          atol(arg.c_str() + interval_arg.length()));
+    }
+  }
+  if (socket_path.empty()) {
+    return nullptr;
+  }
+  return std::make_unique<telemetry_t>(registry, clock, socket_path, interval);
+}
+
+telemetry_t::telemetry_t(widget_registry_t &registry,
+                         clockmodule_t &clock,
+                         const std::string &socket_path,
+                         std::chrono::milliseconds interval)
+    : registry(registry), clock(clock), socket_path(socket_path),
+      interval(interval) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Telemetry socket path is too long: %s\n",
+            socket_path.c_str());
+    abort();
+  }
+  strcpy(addr.sun_path, socket_path.c_str());
+
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    perror("telemetry socket");
+    abort();
+  }
+  unlink(socket_path.c_str());
+  // Restrict the socket to the current user.
+  const mode_t mask = umask(0077);
+  const int bound = bind(listen_fd, (sockaddr *)&addr, sizeof(addr));
+  umask(mask);
+  if (bound != 0 || listen(listen_fd, 4) != 0) {
+    fprintf(stderr, "Cannot listen on telemetry socket %s: %s\n",
+            socket_path.c_str(), strerror(errno));
+    abort();
+  }
+
+  start_time = steady::now();
+  server = std::thread([this] { serve(); });
+  fprintf(stderr, "Publishing telemetry on %s\n", socket_path.c_str());
+}
+
+telemetry_t::~telemetry_t() {
+  stopping = true;
+  server.join();
+  close(listen_fd);
+  unlink(socket_path.c_str());
+}
+
+void telemetry_t::timed_tick(bridge_driver_t &bridge) {
+  const auto start = steady::now();
+  bridge.tick();
+  const auto end = steady::now();
+
+  auto &stats = tick_stats[&bridge];
+  stats.samples++;
+  stats.total += end - start;
+
+  if (end - last.time >= interval) {
+    refresh(end);
+  }
+}
+
+telemetry_t::counters_t telemetry_t::sample_counters(steady::time_point now) {
+  counters_t counters;
+  counters.time = now;
+  counters.tcycle = clock.cached_tcycle();
+  counters.hcycle = clock.cached_hcycle();
+  for_each_stream(registry, [&](const char *, const char *, int, uint64_t n) {
+    counters.stream_bytes.push_back(n);
+  });
+  return counters;
+}
+
+void telemetry_t::refresh(steady::time_point now) {
+  counters_t current = sample_counters(now);
+  const bool first = last.time == steady::time_point();
+  const double dt = std::chrono::duration<double>(now - last.time).count();
+  const uint64_t dtcycle = current.tcycle - last.tcycle;
+  const uint64_t dhcycle = current.hcycle - last.hcycle;
+
+  std::ostringstream os;
+  os << "{\"time_s\":"
+     << std::chrono::duration<double>(now - start_time).count()
+     << ",\"target_cycle\":" << current.tcycle
+     << ",\"host_cycle\":" << current.hcycle;
+  if (!first && dt > 0) {
+    os << ",\"target_mhz\":" << dtcycle / dt / 1e6
+       << ",\"host_mhz\":" << dhcycle / dt / 1e6;
+  }
+  if (!first && dtcycle != 0) {
+    os << ",\"fmr\":" << (double)dhcycle / dtcycle;
+  }
+
+  os << ",\"streams\":[";
+  size_t k = 0;
+  for_each_stream(registry, [&](const char *engine,
+                                const char *direction,
+                                int index,
+                                uint64_t bytes) {
+    os << (k ? "," : "") << "{\"engine\":\"" << engine
+       << "\",\"direction\":\"" << direction << "\",\"index\":" << index
+       << ",\"bytes\":" << bytes;
+    if (!first && dt > 0) {
+      os << ",\"bytes_per_s\":" << (bytes - last.stream_bytes[k]) / dt;
+    }
+    os << "}";
+    k++;
+  });
+
+  os << "],\"bridges\":[";
+  const auto &bridges = registry.get_all_bridges();
+  for (size_t i = 0; i < bridges.size(); i++) {
+    auto it = tick_stats.find(bridges[i]);
+    os << (i ? "," : "") << "{\"index\":" << i;
+    if (it != tick_stats.end()) {
+      auto &stats = it->second;
+      os << ",\"sampled_ticks\":" << stats.samples << ",\"mean_tick_ns\":"
+         << stats.total.count() / stats.samples;
+    }
+    os << "}";
+  }
+  os << "]}\n";
+
+  last = std::move(current);
+  std::lock_guard<std::mutex> lock(snapshot_mutex);
+  snapshot = os.str();
+}
+
+void telemetry_t::serve() {
+  pollfd pfd = {listen_fd, POLLIN, 0};
+  while (!stopping) {
+    // Wake up periodically to check whether the simulation is over.
+    if (poll(&pfd, 1, 100) <= 0) {
+      continue;
+    }
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+
+    std::string data;
+    {
+      std::lock_guard<std::mutex> lock(snapshot_mutex);
+      data = snapshot;
+    }
+    for (size_t sent = 0; sent < data.size();) {
+      ssize_t n =
+          send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+    close(fd);
+  }
+}
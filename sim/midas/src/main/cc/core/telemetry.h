@@ -0,0 +1,106 @@
+// See LICENSE for license details.
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/bridge_driver.h"
+
+class clockmodule_t;
+class widget_registry_t;
+
+/**
+ * Publishes live metrics of a running simulation over a Unix domain socket.
+ *
+ * Enabled with +telemetry-socket=<path>. Every local client connecting to the
+ * socket receives the latest snapshot as a single JSON object, after which the
+ * connection is closed (ex. `socat - UNIX-CONNECT:<path>`). The socket is only
+ * accessible to the user running the simulation.
+ *
+ * Snapshots are built by the driver thread at most every
+ * +telemetry-interval-ms=<n> milliseconds (1000 by default) from counters the
+ * driver already maintains: the cached cycle counters of the clock bridge and
+ * the byte counts of streams. Rates are computed over the last interval. The
+ * cost of bridge ticks is measured on a sample of the ticks issued through
+ * `tick_bridge`. Clients are served by a helper thread which never touches
+ * the simulation.
+ */
+class telemetry_t final {
+public:
+  /**
+   * Creates the telemetry server if the plusargs request one.
+   */
+  static std::unique_ptr<telemetry_t>
+  from_args(widget_registry_t &registry,
+            clockmodule_t &clock,
+            const std::vector<std::string> &args);
+
+  telemetry_t(widget_registry_t &registry,
+              clockmodule_t &clock,
+              const std::string &socket_path,
+              std::chrono::milliseconds interval);
+  ~telemetry_t();
+
+  /**
+   * Ticks a bridge, timing a sample of the ticks.
+   */
+  void tick_bridge(bridge_driver_t &bridge) {
+    if (++tick_count % tick_sample_period != 0) {
+      bridge.tick();
+      return;
+    }
+    timed_tick(bridge);
+  }
+
+private:
+  using steady = std::chrono::steady_clock;
+
+  /// Measure one tick out of this many, a prime to avoid aliasing with the
+  /// number of bridges.
+  static constexpr uint64_t tick_sample_period = 61;
+
+  struct tick_stats_t {
+    uint64_t samples = 0;
+    std::chrono::nanoseconds total{0};
+  };
+
+  /// Counter values at the time of the last snapshot.
+  struct counters_t {
+    steady::time_point time;
+    uint64_t tcycle = 0;
+    uint64_t hcycle = 0;
+    std::vector<uint64_t> stream_bytes;
+  };
+
+  void timed_tick(bridge_driver_t &bridge);
+  void refresh(steady::time_point now);
+  counters_t sample_counters(steady::time_point now);
+  void serve();
+
+  widget_registry_t &registry;
+  clockmodule_t &clock;
+  const std::string socket_path;
+  const std::chrono::milliseconds interval;
+
+  uint64_t tick_count = 0;
+  std::unordered_map<bridge_driver_t *, tick_stats_t> tick_stats;
+  steady::time_point start_time;
+  counters_t last;
+
+  int listen_fd = -1;
+  std::atomic<bool> stopping = false;
+  std::thread server;
+  /// Latest snapshot, shared with the server thread.
+  std::mutex snapshot_mutex;
+  std::string snapshot = "{}\n";
+};
+
+#endif // __TELEMETRY_H
@@ -0,0 +1,28 @@
+// See LICENSE for license details.
+
+#include "wait_policy.h"
+
+#include <cstdlib>
+
+wait_policy_t wait_policy_t::from_args(const std::vector<std::string> &args) {
+  std::string spin_polls_arg = std::string("+wait-spin-polls=");
+  std::string max_backoff_arg = std::string("+wait-max-backoff-us=");
+  std::string timeout_check_arg = std::string("+wait-timeout-check=");
+
+  wait_policy_t policy;
+  for (auto &arg : args) {
+    if (arg.find(spin_polls_arg) == 0) {
+      policy.spin_polls = atoi(arg.c_str() + spin_polls_arg.length());
+    }
+    if (arg.find(max_backoff_arg) == 0) {
+      policy.max_backoff = std::chrono::microseconds(
+          atol(arg.c_str() + max_backoff_arg.length()));
+      policy.min_backoff = std::min(policy.min_backoff, policy.max_backoff);
+    }
+    if (arg.find(timeout_check_arg) == 0) {
+      policy.timeout_check_period =
+          std::max(1, atoi(arg.c_str() + timeout_check_arg.length()));
+    }
+  }
+  return policy;
+}
@@ -0,0 +1,89 @@
+// See LICENSE for license details.
+
+#ifndef __WAIT_POLICY_H
+#define __WAIT_POLICY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "core/simif.h"
+
+/**
+ * Strategy for polling a condition over MMIO until it holds.
+ *
+ * A tight polling loop saturates the control bus and burns a host core for
+ * as long as the wait lasts. Instead, a waiter:
+ *   1) if it knows roughly how long the wait should take, lets the host idle
+ *      through most of it before polling at all,
+ *   2) polls back to back for a few iterations, catching short waits,
+ *   3) backs off exponentially between polls, up to a maximum delay.
+ * The clock is only read every few polls to check for timeouts.
+ *
+ * Delays are implemented by `simif_t::host_delay`, which lets platforms
+ * decide how to idle. The policy is configured through plusargs:
+ *   +wait-spin-polls=<n>       polls issued back to back before backing off
+ *   +wait-max-backoff-us=<n>   maximum delay between polls
+ *   +wait-timeout-check=<n>    polls between checks of the timeout
+ */
+class wait_policy_t final {
+public:
+  using clock = std::chrono::steady_clock;
+
+  static wait_policy_t from_args(const std::vector<std::string> &args);
+
+  /**
+   * Polls `ready` until it returns true or `timeout` seconds elapse. The
+   * timeout can be infinite.
+   *
+   * @param expected Predicted duration of the wait in seconds, 0 if unknown.
+   * @param polls If not null, set to the number of polls issued.
+   * @returns False if the wait timed out.
+   */
+  template <typename F>
+  bool wait(simif_t &simif,
+            F &&ready,
+            double timeout,
+            double expected = 0.0,
+            unsigned *polls = nullptr) const {
+    const auto deadline =
+        std::isfinite(timeout)
+            ? clock::now() + std::chrono::duration_cast<clock::duration>(
+                                 std::chrono::duration<double>(timeout))
+            : clock::time_point::max();
+
+    // Idle through most of the expected duration, leaving some slack to
+    // absorb errors in the prediction.
+    if (expected > 0.0) {
+      simif.host_delay(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double>(std::min(expected, timeout) * 0.9)));
+    }
+
+    auto backoff = min_backoff;
+    for (unsigned n = 1;; n++) {
+      if (polls)
+        *polls = n;
+      if (ready())
+        return true;
+      if (n % timeout_check_period == 0 && clock::now() > deadline)
+        return false;
+      if (n >= spin_polls) {
+        simif.host_delay(backoff);
+        backoff = std::min(backoff * 2, max_backoff);
+      }
+    }
+  }
+
+  /// Polls issued back to back before backing off.
+  unsigned spin_polls = 64;
+  /// Initial delay between polls once backing off.
+  std::chrono::nanoseconds min_backoff{1000};
+  /// Maximum delay between polls.
+  std::chrono::nanoseconds max_backoff{100000};
+  /// Number of polls between checks of the timeout.
+  unsigned timeout_check_period = 32;
+};
+
+#endif // __WAIT_POLICY_H
@@ -1,11 +1,14 @@
 // See LICENSE for license details.
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <iostream>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "mm.h"
 
@@ -22,6 +25,7 @@ void mm_t::write(uint64_t addr,
   addr %= this->size;
 
   uint8_t *base = this->data + (addr / word_size) * word_size;
+  written_pages[(base - this->data) / page_size] = true;
   for (int i = 0; i < word_size; i++) {
     if (strb & 1)
       base[i] = data[i];
@@ -29,6 +33,23 @@ void mm_t::write(uint64_t addr,
   }
 }
 
+void mm_t::write_bytes(uint64_t addr, const uint8_t *data, size_t size) {
+  assert(addr + size <= this->size);
+  memcpy(this->data + addr, data, size);
+  mark_written(addr, size);
+}
+
+void mm_t::mark_written(uint64_t addr, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const size_t first = addr / page_size;
+  const size_t last = (addr + size - 1) / page_size;
+  std::fill(written_pages.begin() + first,
+            written_pages.begin() + last + 1,
+            true);
+}
+
 std::vector<char> mm_t::read(uint64_t addr) {
   addr %= this->size;
 
@@ -52,6 +73,21 @@ void mm_t::init(size_t sz, int lsz) {
   }
 
   size = sz;
+  page_size = sysconf(_SC_PAGESIZE);
+  written_pages.assign((sz + page_size - 1) / page_size, false);
+}
+
+void mm_t::save_mem(const char *fname) {
+  // Pages which were never written are zero and are not read, keeping the
+  // untouched parts of the backing memory uncommitted. `append` also skips
+  // written pages of zeros.
+  memory_image_t image;
+  for (size_t page = 0; page < written_pages.size(); page++) {
+    const uint64_t addr = page * page_size;
+    const size_t n = std::min<size_t>(page_size, size - addr);
+    image.append(addr, written_pages[page] ? data + addr : nullptr, n);
+  }
+  image.save(fname);
 }
 
 mm_t::~mm_t() {
@@ -136,29 +172,50 @@ void mm_magic_t::tick(bool reset,
   }
 }
 
-void mm_t::load_mem(unsigned long start, const char *fname) {
-  std::string line;
-  std::ifstream in(fname);
-  unsigned long fsize = 0;
-
-  if (!in.is_open()) {
-    fprintf(stderr, "Couldn't open loadmem file %s\n", fname);
-    abort();
-  }
-
-  while (std::getline(in, line)) {
-#define parse_nibble(c) ((c) >= 'a' ? (c) - 'a' + 10 : (c) - '0')
-    for (ssize_t i = line.length() - 2, j = 0; i >= 0; i -= 2, j++) {
-      char byte = (parse_nibble(line[i]) << 4) | parse_nibble(line[i + 1]);
-      ssize_t addr = (start + j) % size;
-      data[addr] = byte;
+void mm_t::load_mem(unsigned long start,
+                    const char *fname,
+                    const memory_image_options_t &options) {
+  // Map cached images copy-on-write over the backing memory: pages are only
+  // read from the file when first accessed.
+  std::string cache = memory_image_t::binary_cache(fname, options);
+  if (!cache.empty() && start % sysconf(_SC_PAGESIZE) == 0) {
+    int fd = open(cache.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      fprintf(stderr, "Couldn't open loadmem file %s\n", cache.c_str());
+      abort();
     }
-    start += line.length() / 2;
-    fsize += line.length() / 2;
-
-    if (fsize > this->size) {
+    if (start + st.st_size > size) {
       fprintf(stderr, "Loadmem file is too large\n");
       abort();
     }
+    if (st.st_size != 0 && mmap(data + start,
+                                st.st_size,
+                                PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_FIXED,
+                                fd,
+                                0) == MAP_FAILED) {
+      std::perror("[mm_t] mmap of memory image failed");
+      abort();
+    }
+    close(fd);
+    mark_written(start, st.st_size);
+    return;
+  }
+
+  memory_image_t image = memory_image_t::load(fname, options);
+  if (start + image.end() > size) {
+    fprintf(stderr, "Loadmem file is too large\n");
+    abort();
+  }
+
+  // The backing memory is freshly mapped and thus already zero: only the
+  // initialized bytes of segments are copied, leaving .bss and the gaps
+  // between segments untouched.
+  for (auto &segment : image.segments) {
+    memcpy(data + start + segment.addr,
+           segment.data.data(),
+           segment.data.size());
+    mark_written(start + segment.addr, segment.data.size());
   }
 }
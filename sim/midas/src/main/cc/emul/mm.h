@@ -4,6 +4,7 @@
 #define __EMUL_MM_H
 
 #include "core/config.h"
+#include "core/memory_image.h"
 
 #include <cstring>
 #include <queue>
@@ -60,9 +61,33 @@ public:
   void write(uint64_t addr, const uint8_t *data, uint64_t strb, uint64_t size);
   std::vector<char> read(uint64_t addr);
 
+  /**
+   * Copies a range of bytes into memory on behalf of the host, bypassing the
+   * AXI4 interface.
+   */
+  void write_bytes(uint64_t addr, const uint8_t *data, size_t size);
+
   virtual ~mm_t();
 
-  void load_mem(unsigned long start, const char *fname);
+  /**
+   * Loads a hex or ELF image into memory, at an offset of `start`.
+   *
+   * Cached binary images are mapped copy-on-write over the backing memory
+   * instead of being copied into it.
+   */
+  void load_mem(unsigned long start,
+                const char *fname,
+                const memory_image_options_t &options =
+                    memory_image_options_t());
+
+  /**
+   * Saves the contents of memory to a sparse snapshot, which `load_mem`
+   * accepts. Only pages which were written, through `write`, `write_bytes`
+   * or `load_mem`, are read: the others are recorded as zeros without being
+   * touched, which would commit them in host memory. Written pages holding
+   * only zeros are recorded without their contents as well.
+   */
+  void save_mem(const char *fname);
 
   const AXI4Config &get_config() const { return conf; }
 
@@ -73,6 +98,16 @@ protected:
   uint8_t *data;
   size_t size;
   int line_size;
+
+private:
+  /**
+   * Marks the pages overlapping a range of memory as written.
+   */
+  void mark_written(uint64_t addr, size_t size);
+
+  size_t page_size = 0;
+  /// Pages which were written since memory was mapped.
+  std::vector<bool> written_pages;
 };
 
 struct mm_rresp_t {
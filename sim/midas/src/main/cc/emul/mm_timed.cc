@@ -0,0 +1,137 @@
+// See LICENSE for license details.
+
+#include "mm_timed.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
+void mm_timed_t::init(size_t sz, int lsz) {
+  mm_t::init(sz, lsz);
+  assert(timing.banks > 0 && timing.max_inflight > 0);
+  dummy_data.resize(word_size);
+  bank_free_cycle.assign(timing.banks, 0);
+  read_histogram.assign(histogram_bins, 0);
+  write_histogram.assign(histogram_bins, 0);
+}
+
+void *mm_timed_t::r_data() {
+  if (!r_valid()) {
+    return &dummy_data[0];
+  }
+  auto &r = reads.front();
+  beat_data = read(r.addr + r.beat * word_size);
+  return &beat_data[0];
+}
+
+bool mm_timed_t::r_last() {
+  return r_valid() && reads.front().beat + 1 == reads.front().beats;
+}
+
+uint64_t mm_timed_t::reserve_bank(uint64_t addr, uint64_t beats) {
+  // Bursts are short relative to the interleaving of lines, so all beats of a
+  // burst are charged to the bank holding its first line.
+  auto &bank_free = bank_free_cycle[(addr / line_size) % timing.banks];
+  uint64_t start = std::max(cycle, bank_free);
+  bank_free = start + beats * timing.bank_busy;
+  return start;
+}
+
+void mm_timed_t::record(std::vector<uint64_t> &histogram,
+                        uint64_t start_cycle) {
+  histogram[std::min<uint64_t>(cycle - start_cycle, histogram_bins - 1)]++;
+}
+
+void mm_timed_t::tick(bool reset,
+
+                      bool ar_valid,
+                      uint64_t ar_addr,
+                      uint64_t ar_id,
+                      uint64_t ar_size,
+                      uint64_t ar_len,
+
+                      bool aw_valid,
+                      uint64_t aw_addr,
+                      uint64_t aw_id,
+                      uint64_t aw_size,
+                      uint64_t aw_len,
+
+                      bool w_valid,
+                      uint64_t w_strb,
+                      const std::vector<uint32_t> &w_data,
+                      bool w_last,
+
+                      bool r_ready,
+                      bool b_ready) {
+  bool ar_fire = !reset && ar_valid && ar_ready();
+  bool aw_fire = !reset && aw_valid && aw_ready();
+  bool w_fire = !reset && w_valid && w_ready();
+  bool r_fire = !reset && r_valid() && r_ready;
+  bool b_fire = !reset && b_valid() && b_ready;
+
+  if (r_fire) {
+    auto &r = reads.front();
+    if (++r.beat == r.beats) {
+      record(read_histogram, r.start_cycle);
+      reads.pop_front();
+    }
+  }
+
+  if (b_fire) {
+    record(write_histogram, bresps.front().start_cycle);
+    bresps.pop_front();
+  }
+
+  if (w_fire) {
+    auto &w = writes.front();
+    write(w.addr + w.beat * w.size,
+          (const uint8_t *)w_data.data(),
+          w_strb,
+          w.size);
+    if (++w.beat == w.beats) {
+      assert(w_last);
+      uint64_t start = reserve_bank(w.addr, w.beats);
+      bresps.push_back({w.id, w.start_cycle, start + timing.write_latency});
+      writes.pop_front();
+    }
+  }
+
+  if (ar_fire) {
+    uint64_t beats = ar_len + 1;
+    uint64_t start = reserve_bank(ar_addr, beats);
+    reads.push_back({ar_id,
+                     (ar_addr / word_size) * word_size,
+                     beats,
+                     0,
+                     cycle,
+                     start + timing.read_latency});
+  }
+
+  if (aw_fire) {
+    writes.push_back(
+        {aw_id, aw_addr, 1ULL << aw_size, aw_len + 1, 0, cycle});
+  }
+
+  cycle++;
+
+  if (reset) {
+    reads.clear();
+    writes.clear();
+    bresps.clear();
+    std::fill(bank_free_cycle.begin(), bank_free_cycle.end(), 0);
+    cycle = 0;
+  }
+}
+
+void mm_timed_t::write_histograms(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    fprintf(stderr, "Could not open histogram file %s\n", path.c_str());
+    return;
+  }
+  file << "latency,reads,writes" << std::endl;
+  for (size_t i = 0; i < histogram_bins; i++) {
+    file << i << "," << read_histogram[i] << "," << write_histogram[i]
+         << std::endl;
+  }
+}
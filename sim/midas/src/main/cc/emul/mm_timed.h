@@ -0,0 +1,145 @@
+// See LICENSE for license details.
+
+#ifndef __EMUL_MM_TIMED_H
+#define __EMUL_MM_TIMED_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "emul/mm.h"
+
+/**
+ * Timing parameters of the host memory model, in host memory cycles.
+ */
+struct mm_timing_t {
+  /// Cycles from the start of a read to its first data beat.
+  uint64_t read_latency = 40;
+  /// Cycles from the start of a write to its response.
+  uint64_t write_latency = 40;
+  /// Number of independent banks. Lines are interleaved across banks.
+  unsigned banks = 8;
+  /// Cycles a bank stays busy for each beat it transfers.
+  uint64_t bank_busy = 4;
+  /// Maximum number of outstanding reads and of outstanding writes.
+  size_t max_inflight = 16;
+};
+
+/**
+ * Host memory model answering requests with configurable latency.
+ *
+ * Unlike `mm_magic_t`, which responds to all requests in the cycle following
+ * them, this model delays responses by a fixed latency and accounts for bank
+ * conflicts: each beat keeps its bank busy for a number of cycles, limiting
+ * the bandwidth of accesses hitting the same bank. Requests are queued up to a
+ * maximum depth, beyond which the model applies back-pressure. Responses are
+ * returned in order.
+ *
+ * The model records histograms of the latency of all transactions, measured
+ * from the acceptance of the request to the last beat of the response.
+ */
+class mm_timed_t final : public mm_t {
+public:
+  mm_timed_t(const AXI4Config &conf, const mm_timing_t &timing)
+      : mm_t(conf), timing(timing) {}
+
+  void init(size_t sz, int lsz) override;
+
+  bool ar_ready() override { return reads.size() < timing.max_inflight; }
+  bool aw_ready() override {
+    return writes.size() + bresps.size() < timing.max_inflight;
+  }
+  bool w_ready() override { return !writes.empty(); }
+  bool b_valid() override {
+    return !bresps.empty() && bresps.front().ready_cycle <= cycle;
+  }
+  uint64_t b_resp() override { return 0; }
+  uint64_t b_id() override { return b_valid() ? bresps.front().id : 0; }
+  bool r_valid() override {
+    return !reads.empty() && reads.front().ready_cycle <= cycle;
+  }
+  uint64_t r_resp() override { return 0; }
+  uint64_t r_id() override { return r_valid() ? reads.front().id : 0; }
+  void *r_data() override;
+  bool r_last() override;
+
+  void tick(bool reset,
+
+            bool ar_valid,
+            uint64_t ar_addr,
+            uint64_t ar_id,
+            uint64_t ar_size,
+            uint64_t ar_len,
+
+            bool aw_valid,
+            uint64_t aw_addr,
+            uint64_t aw_id,
+            uint64_t aw_size,
+            uint64_t aw_len,
+
+            bool w_valid,
+            uint64_t w_strb,
+            const std::vector<uint32_t> &w_data,
+            bool w_last,
+
+            bool r_ready,
+            bool b_ready) override;
+
+  /**
+   * Writes the read and write latency histograms to a CSV file.
+   */
+  void write_histograms(const std::string &path) const;
+
+  /// Number of histogram bins. The last bin counts all longer latencies.
+  static constexpr size_t histogram_bins = 1024;
+
+private:
+  struct read_t {
+    uint64_t id;
+    uint64_t addr;
+    uint64_t beats;
+    uint64_t beat;
+    uint64_t start_cycle;
+    uint64_t ready_cycle;
+  };
+
+  struct write_t {
+    uint64_t id;
+    uint64_t addr;
+    uint64_t size;
+    uint64_t beats;
+    uint64_t beat;
+    uint64_t start_cycle;
+  };
+
+  struct bresp_t {
+    uint64_t id;
+    uint64_t start_cycle;
+    uint64_t ready_cycle;
+  };
+
+  /**
+   * Reserves the bank holding a line for a number of beats, returning the
+   * cycle at which the access can start.
+   */
+  uint64_t reserve_bank(uint64_t addr, uint64_t beats);
+
+  void record(std::vector<uint64_t> &histogram, uint64_t start_cycle);
+
+  const mm_timing_t timing;
+
+  std::deque<read_t> reads;
+  // Writes accepted on AW, waiting for their data beats.
+  std::deque<write_t> writes;
+  std::deque<bresp_t> bresps;
+  std::vector<uint64_t> bank_free_cycle;
+  std::vector<char> beat_data;
+  std::vector<char> dummy_data;
+
+  std::vector<uint64_t> read_histogram;
+  std::vector<uint64_t> write_histogram;
+
+  uint64_t cycle = 0;
+};
+
+#endif // __EMUL_MM_TIMED_H
@@ -6,7 +6,9 @@
 #include "bridges/fpga_managed_stream.h"
 #include "core/simulation.h"
 #include "emul/mm.h"
+#include "emul/mm_timed.h"
 #include "emul/mmio.h"
+#include <algorithm>
 #include <cassert>
 #include <memory>
 #include <string.h>
@@ -18,11 +20,12 @@ simif_emul_t::simif_emul_t(const TargetConfig &config,
 
   // Parse arguments.
   memsize = 1L << config.mem.addr_bits;
-  bool fastloadmem = false;
   int fpga_cnt = 1;
   int fpga_idx = 0;
   bool noc_part = false;
   bool comb_logic = false;
+  bool timed_memory = false;
+  mm_timing_t mem_timing;
   for (auto arg : args) {
     if (arg.find("+fastloadmem") == 0) {
       fastloadmem = true;
@@ -53,6 +56,36 @@ simif_emul_t::simif_emul_t(const TargetConfig &config,
       else if (fpga_topo_str == 2)
         noc_part = true;
     }
+    if (arg.find("+host-mem-model=") == 0) {
+      std::string model(arg.c_str() + 16);
+      if (model == "timed") {
+        timed_memory = true;
+      } else if (model != "magic") {
+        fprintf(stderr, "Unknown host memory model: %s\n", model.c_str());
+        abort();
+      }
+    }
+    if (arg.find("+host-mem-read-latency=") == 0) {
+      mem_timing.read_latency = strtoull(arg.c_str() + 23, NULL, 10);
+    }
+    if (arg.find("+host-mem-write-latency=") == 0) {
+      mem_timing.write_latency = strtoull(arg.c_str() + 24, NULL, 10);
+    }
+    if (arg.find("+host-mem-banks=") == 0) {
+      mem_timing.banks = atoi(arg.c_str() + 16);
+    }
+    if (arg.find("+host-mem-bank-busy=") == 0) {
+      mem_timing.bank_busy = strtoull(arg.c_str() + 20, NULL, 10);
+    }
+    if (arg.find("+host-mem-max-inflight=") == 0) {
+      mem_timing.max_inflight = strtoull(arg.c_str() + 23, NULL, 10);
+    }
+    if (arg.find("+host-mem-snapshot=") == 0) {
+      mem_snapshot_path = arg.c_str() + 19;
+    }
+    if (arg.find("+host-mem-restore=") == 0) {
+      mem_restore_path = arg.c_str() + 18;
+    }
   }
 
   for (int i = 0; i < config.qsfp.num_channels; i++) {
@@ -125,14 +158,27 @@ simif_emul_t::simif_emul_t(const TargetConfig &config,
   if (!fastloadmem)
     load_mem_path.clear();
 
+  image_options = memory_image_t::parse_args(args);
   fuzz_gen.seed(fuzz_seed);
 
   // Initialise memories.
   for (unsigned i = 0; i < config.mem_num_channels; ++i) {
-    slave.emplace_back(std::make_unique<mm_magic_t>(config.mem));
+    if (timed_memory) {
+      slave.emplace_back(std::make_unique<mm_timed_t>(config.mem, mem_timing));
+    } else {
+      slave.emplace_back(std::make_unique<mm_magic_t>(config.mem));
+    }
     (*slave.rbegin())->init(memsize, 64);
   }
 
+  if (!mem_restore_path.empty()) {
+    for (size_t i = 0; i < slave.size(); i++) {
+      std::string path = get_snapshot_path(mem_restore_path, i);
+      fprintf(stdout, "Restoring host memory %zu from %s\n", i, path.c_str());
+      slave[i]->load_mem(0, path.c_str());
+    }
+  }
+
   // Set up the managed stream.
   if (std::optional<AXI4Config> conf = config.cpu_managed) {
     assert(!config.fpga_managed && "stream should be CPU or FPGA managed");
@@ -279,15 +325,125 @@ simif_emul_t::FPGAManagedStreamIOImpl::FPGAManagedStreamIOImpl(
 }
 
 void simif_emul_t::load_mems(const char *fname) {
-  // TODO: allow file to be split across slaves
-  if (!slave.empty()) {
-    slave[0]->load_mem(0, fname);
+  if (slave.empty()) {
+    return;
+  }
+
+  // A single channel loads the image by itself, which lets it map cached
+  // images instead of copying them.
+  if (slave.size() == 1) {
+    slave[0]->load_mem(0, fname, image_options);
+    return;
+  }
+
+  memory_image_t image = memory_image_t::load(fname, image_options);
+  const uint64_t channel_size = get_channel_size();
+  if (image.end() > channel_size * slave.size()) {
+    fprintf(stderr, "Loadmem file is too large\n");
+    abort();
+  }
+
+  // Each channel copies the parts of the segments falling into its region
+  // from its own thread.
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < slave.size(); i++) {
+    threads.emplace_back([&, i] {
+      const uint64_t base = i * channel_size;
+      for (auto &segment : image.segments) {
+        const uint64_t start = std::max(segment.addr, base);
+        const uint64_t end = std::min(segment.addr + segment.data.size(),
+                                      base + channel_size);
+        if (start < end) {
+          write_mems(
+              start, segment.data.data() + start - segment.addr, end - start);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
   }
 }
 
+bool simif_emul_t::write_dram(uint64_t addr,
+                              const uint8_t *data,
+                              size_t size) {
+  if (!fastloadmem || slave.empty()) {
+    return false;
+  }
+  write_mems(addr, data, size);
+  return true;
+}
+
+bool simif_emul_t::read_dram(uint64_t addr, uint8_t *data, size_t size) {
+  if (!fastloadmem || slave.empty()) {
+    return false;
+  }
+  read_mems(addr, data, size);
+  return true;
+}
+
+void simif_emul_t::host_delay(std::chrono::nanoseconds delay) {
+  // A tick of the RTL simulator costs far more than the delays requested by
+  // pollers, which are sized for an FPGA: converting them into ticks would
+  // stall the driver for much longer than the target needs. Advance the
+  // target by a bounded number of cycles instead, as other accesses do.
+  advance_target();
+}
+
+template <typename F>
+void simif_emul_t::for_each_channel(uint64_t addr, size_t size, F f) {
+  // Channels are mapped to contiguous regions of the host address space,
+  // each as large as the address space of a channel: split accesses at
+  // channel boundaries.
+  const uint64_t channel_size = get_channel_size();
+  while (size != 0) {
+    const uint64_t channel = addr / channel_size;
+    const uint64_t offset = addr % channel_size;
+    if (channel >= slave.size() || offset >= slave[channel]->get_size()) {
+      fprintf(stderr,
+              "[fast loadmem] address 0x%llx is beyond host memory\n",
+              (unsigned long long)addr);
+      abort();
+    }
+    auto &mem = *slave[channel];
+    const size_t n = std::min<uint64_t>(
+        {size, channel_size - offset, mem.get_size() - offset});
+    f(mem, offset, n);
+    addr += n;
+    size -= n;
+  }
+}
+
+void simif_emul_t::write_mems(uint64_t addr, const uint8_t *data, size_t size) {
+  for_each_channel(addr, size, [&](mm_t &mem, uint64_t offset, size_t n) {
+    mem.write_bytes(offset, data, n);
+    data += n;
+  });
+}
+
+void simif_emul_t::read_mems(uint64_t addr, uint8_t *data, size_t size) {
+  for_each_channel(addr, size, [&](mm_t &mem, uint64_t offset, size_t n) {
+    memcpy(data, (char *)mem.get_data() + offset, n);
+    data += n;
+  });
+}
+
 int simif_emul_t::end() {
   assert(finished && "simulation not yet finished");
   thread.join();
+
+  for (size_t i = 0; i < slave.size(); i++) {
+    if (auto *timed = dynamic_cast<mm_timed_t *>(slave[i].get())) {
+      timed->write_histograms("host-mem-latency" + std::to_string(i) + ".csv");
+    }
+  }
+
+  if (!mem_snapshot_path.empty()) {
+    for (size_t i = 0; i < slave.size(); i++) {
+      slave[i]->save_mem(get_snapshot_path(mem_snapshot_path, i).c_str());
+    }
+  }
   return exit_code;
 }
 
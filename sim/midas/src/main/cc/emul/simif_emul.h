@@ -13,6 +13,7 @@
 
 #include "bridges/cpu_managed_stream.h"
 #include "bridges/fpga_managed_stream.h"
+#include "core/memory_image.h"
 #include "core/simif.h"
 #include "emul/mm.h"
 #include "emul/mmio.h"
@@ -74,6 +75,19 @@ public:
   void write(size_t addr, uint32_t data) override;
   uint32_t read(size_t addr) override;
 
+  /**
+   * With +fastloadmem, accesses the host DRAM models directly instead of
+   * going through the loadmem widget.
+   */
+  bool write_dram(uint64_t addr, const uint8_t *data, size_t size) override;
+  bool read_dram(uint64_t addr, uint8_t *data, size_t size) override;
+
+  /**
+   * The RTL simulator only advances while the driver accesses it: instead of
+   * sleeping, ticks the simulation by a bounded number of cycles.
+   */
+  void host_delay(std::chrono::nanoseconds delay) override;
+
   // void sync_sockets() override;
 
   /**
@@ -147,11 +161,35 @@ protected:
 
   uint64_t memsize;
 
+  /**
+   * Set by +fastloadmem: the driver writes directly into host DRAM models.
+   */
+  bool fastloadmem = false;
+
   /**
    * If +fastloadmem and +loadmem are set, memories are loaded from this file.
    */
   std::string load_mem_path;
 
+  /**
+   * With +host-mem-snapshot=<prefix>, the host DRAM models are saved to
+   * <prefix>.<channel> once the simulation ends. With
+   * +host-mem-restore=<prefix>, they are restored from such files before it
+   * starts, ahead of +fastloadmem images.
+   */
+  std::string mem_snapshot_path;
+  std::string mem_restore_path;
+
+  static std::string get_snapshot_path(const std::string &prefix,
+                                       size_t channel) {
+    return prefix + "." + std::to_string(channel);
+  }
+
+  /**
+   * Options of the loader of memory images.
+   */
+  memory_image_options_t image_options;
+
   /**
    * Advances the simulation by a random number of ticks.
    *
@@ -166,9 +204,37 @@ protected:
   void wait_read(mmio_t &mmio, void *data);
   void wait_write(mmio_t &mmio);
 
-  // Writes directly into the host DRAM models to initialize them.
+  /**
+   * Writes an image directly into the host DRAM models to initialize them.
+   *
+   * The image is split across channels, which are loaded in parallel.
+   */
   void load_mems(const char *fname);
 
+  /**
+   * Writes into the host DRAM models, splitting the data across channels.
+   */
+  void write_mems(uint64_t addr, const uint8_t *data, size_t size);
+
+  /**
+   * Reads from the host DRAM models, gathering the data across channels.
+   */
+  void read_mems(uint64_t addr, uint8_t *data, size_t size);
+
+  /**
+   * Calls `f(mem, offset, n)` on the parts of a range of host memory
+   * mapped to each channel, in order.
+   */
+  template <typename F>
+  void for_each_channel(uint64_t addr, size_t size, F f);
+
+  /**
+   * Returns the size of the region of host memory mapped to a channel.
+   */
+  uint64_t get_channel_size() const {
+    return 1ULL << slave[0]->get_config().addr_bits;
+  }
+
 private:
   class CPUManagedStreamIOImpl final : public CPUManagedStreamIO {
   public:
@@ -1,9 +1,22 @@
 // See LICENSE for license details.
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
 
 #include "core/config.h"
+#include "core/output_file.h"
 #include "core/simif.h"
+#include "core/simif_trace.h"
 #include "core/simulation.h"
 
 // NOLINTBEGIN
@@ -32,17 +45,47 @@ create_simif(const TargetConfig &config, int argc, char **argv);
 
 std::unique_ptr<simif_t> simulator; // must exist for dpi.cc calls in emulation,
                                     // must be global to avoid deletion
+std::unique_ptr<simif_trace_t> tracer;    // must be global to avoid deletion
 std::unique_ptr<simulation_t> simulation; // must be global to avoid deletion
 
-// Entry point of the driver.
-int entry(int argc, char **argv) {
+/**
+ * Driver instance of a single FPGA slot.
+ */
+struct slot_t {
+  /// Arguments of the slot, which the platform interface may reference.
+  std::vector<std::string> args;
+  std::vector<char *> argv;
+
+  std::unique_ptr<simif_t> simif;
+  std::unique_ptr<simif_trace_t> tracer;
+  std::unique_ptr<simulation_t> simulation;
+};
+
+// Slots hosted by a multi-slot driver, must be global to avoid deletion.
+std::vector<std::unique_ptr<slot_t>> slots;
+
+// Builds the platform interface and the widgets of a driver from its
+// arguments, returning the simulation. If the traffic of the driver is traced,
+// the widgets are built on top of `tracer`, which wraps the platform.
+static std::unique_ptr<simulation_t>
+create_driver(std::unique_ptr<simif_t> &simulator,
+              std::unique_ptr<simif_trace_t> &tracer,
+              int argc,
+              char **argv) {
   // must have this exist for *.const.h
   std::vector<std::string> args(argv + 1, argv + argc);
 
-  // Create the hardware interface.
-  simulator = create_simif(conf_target, argc, argv);
+  // Create the hardware interface, unless a trace stands in for it.
+  auto trace = host_trace_t::from_args(args, conf_target.target_name);
+  if (!trace || !trace->replaying()) {
+    simulator = create_simif(conf_target, argc, argv);
+  }
+  if (trace) {
+    tracer = std::make_unique<simif_trace_t>(
+        conf_target, simulator.get(), std::move(trace));
+  }
   // must have this exist for *.const.h
-  auto &simif = *simulator;
+  simif_t &simif = tracer ? *tracer : *simulator;
 
   /* clang-format off */
   // NOLINTBEGIN
@@ -69,9 +112,229 @@ int entry(int argc, char **argv) {
   // NOLINTEND
   /* clang-format on */
 
+  if (tracer) {
+    tracer->attach(registry);
+  }
+
   // Create the simulation instance.
-  simulation = create_simulation(simif, *widget_registry_ptr, args);
+  return create_simulation(simif, *widget_registry_ptr, args);
+}
+
+// Pins the calling thread to a set of cores.
+static void pin_thread(const std::vector<int> &cores) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int core : cores) {
+    CPU_SET(core, &set);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "Cannot pin slot driver to its cores\n");
+  }
+}
+
+// Assigns cores to slots following the pinning policy. Returns no cores for
+// slots which are not pinned.
+static std::vector<std::vector<int>> assign_cores(const std::string &policy,
+                                                  size_t num_slots,
+                                                  size_t cores_per_slot) {
+  std::vector<std::vector<int>> assignment(num_slots);
+  if (policy.empty() || policy == "none") {
+    return assignment;
+  }
+
+  // Only hand out cores the process is allowed to run on.
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  sched_getaffinity(0, sizeof(set), &set);
+  std::vector<int> cores;
+  for (int i = 0; i < CPU_SETSIZE; i++) {
+    if (CPU_ISSET(i, &set)) {
+      cores.push_back(i);
+    }
+  }
+
+  size_t stride;
+  if (policy == "compact") {
+    // Pack slots onto the lowest-numbered cores.
+    stride = cores_per_slot;
+  } else if (policy == "spread") {
+    // Spread slots evenly over all cores, and thus over all sockets.
+    stride = std::max(cores.size() / num_slots, cores_per_slot);
+  } else {
+    fprintf(stderr, "Unknown slot pinning policy: %s\n", policy.c_str());
+    abort();
+  }
+  if (stride * (num_slots - 1) + cores_per_slot > cores.size()) {
+    fprintf(stderr, "Not enough cores to pin %zu slots\n", num_slots);
+    abort();
+  }
+  for (size_t i = 0; i < num_slots; i++) {
+    for (size_t j = 0; j < cores_per_slot; j++) {
+      assignment[i].push_back(cores[i * stride + j]);
+    }
+  }
+  return assignment;
+}
+
+// Runs the simulations of multiple slots in the same process, one per line
+// of the slot file. Each line holds the plusargs of a slot (ex. +slotid=),
+// which are appended to the arguments of the process. Output files with
+// relative paths, including those of DRAM snapshots, telemetry sockets and
+// host traces, are placed in a directory per slot, slot<i> by default or the
+// one passed to the slot through +slot-output-dir=.
+static int run_slots(int argc, char **argv, const std::string &slot_file) {
+#ifdef RTLSIM
+  // The RTL simulator drives the single global platform interface.
+  fprintf(stderr, "+slot-args is not supported in metasimulation\n");
+  abort();
+#endif
+
+  std::string pinning_arg = std::string("+slot-pinning=");
+  std::string cores_arg = std::string("+slot-cores=");
+  std::string output_dir_arg = std::string("+slot-output-dir=");
+
+  std::vector<std::string> shared_args;
+  std::string pinning;
+  size_t cores_per_slot = 1;
+  for (int i = 0; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.find("+slot-args=") == 0) {
+      continue;
+    }
+    if (arg.find(pinning_arg) == 0) {
+      pinning = arg.substr(pinning_arg.length());
+      continue;
+    }
+    if (arg.find(cores_arg) == 0) {
+      cores_per_slot =
+          std::max(atol(arg.c_str() + cores_arg.length()), 1L);
+      continue;
+    }
+    shared_args.push_back(arg);
+  }
+
+  std::ifstream file(slot_file);
+  if (!file.is_open()) {
+    fprintf(stderr, "Cannot open slot file: %s\n", slot_file.c_str());
+    abort();
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    // Skip blank lines and comments.
+    auto start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] == '#') {
+      continue;
+    }
+    auto slot = std::make_unique<slot_t>();
+    slot->args = shared_args;
+    std::istringstream ss(line);
+    for (std::string arg; ss >> arg;) {
+      slot->args.push_back(arg);
+    }
+    slots.push_back(std::move(slot));
+  }
+  if (slots.empty()) {
+    fprintf(stderr, "No slots in slot file: %s\n", slot_file.c_str());
+    abort();
+  }
+
+  // Relative output paths are placed in the directory of each slot, but
+  // absolute ones would be shared by all slots.
+  const char *path_args[] = {
+      "+dram-snapshot=", "+telemetry-socket=", "+trace-record="};
+  for (const char *path_arg : path_args) {
+    std::set<std::string> paths;
+    for (auto &slot : slots) {
+      for (auto &arg : slot->args) {
+        if (arg.find(path_arg) == 0 && arg[strlen(path_arg)] == '/' &&
+            !paths.insert(arg).second) {
+          fprintf(stderr,
+                  "Slots cannot share the absolute path of %s: use a relative "
+                  "path or give each slot its own\n",
+                  path_arg);
+          abort();
+        }
+      }
+    }
+  }
+
+  const auto cores = assign_cores(pinning, slots.size(), cores_per_slot);
+
+  // Each slot is built and run by its own thread. Pinning the thread before
+  // building the slot places the memory of the slot near its cores.
+  std::vector<int> exit_codes(slots.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < slots.size(); i++) {
+    threads.emplace_back([&, i] {
+      if (!cores[i].empty()) {
+        pin_thread(cores[i]);
+      }
+      auto &slot = *slots[i];
+      std::string output_dir = "slot" + std::to_string(i);
+      for (auto &arg : slot.args) {
+        if (arg.find(output_dir_arg) == 0) {
+          output_dir = arg.substr(output_dir_arg.length());
+        }
+        slot.argv.push_back(arg.data());
+      }
+      slot.argv.push_back(nullptr);
+      output_service_t::set_thread_directory(output_dir);
+      slot.simulation = create_driver(
+          slot.simif, slot.tracer, slot.args.size(), slot.argv.data());
+      simif_t &simif = slot.tracer ? *slot.tracer : *slot.simif;
+      exit_codes[i] = simif.run(*slot.simulation);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < slots.size(); i++) {
+    if (exit_codes[i] != 0) {
+      fprintf(stderr, "Slot %zu failed with code %d\n", i, exit_codes[i]);
+      return exit_codes[i];
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+// Closes the traces of all drivers. Drivers are never destroyed, so their
+// traces must be closed before the output service shuts down at exit.
+static void close_traces() {
+  tracer.reset();
+  for (auto &slot : slots) {
+    slot->tracer.reset();
+  }
+}
+
+// Entry point of the driver.
+int entry(int argc, char **argv) {
+  // must have this exist for *.const.h
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  // Configure the output service before bridges open their files.
+  output_service_t::instance().configure(args);
+  std::atexit(close_traces);
+
+  // A single process can drive multiple FPGA slots, sharing the output
+  // service and the memory images loaded into the slots.
+  for (auto &arg : args) {
+    if (arg.find("+slot-args=") == 0) {
+      return run_slots(argc, argv, arg.substr(11));
+    }
+  }
+
+  simulation = create_driver(simulator, tracer, argc, argv);
 
   // Run the simulation with the given implementation.
-  return simif.run(*simulation);
+  simif_t &simif = tracer ? *tracer : *simulator;
+  const int exit_code = simif.run(*simulation);
+#ifdef RTLSIM
+  // A replayed simulation has already run to completion: the RTL simulator
+  // must not start ticking a platform which was never created.
+  if (!simulator) {
+    exit(exit_code);
+  }
+#endif
+  return exit_code;
 }
@@ -0,0 +1,482 @@
+// See LICENSE for license details.
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+#include "bridges/cpu_managed_stream.h"
+#include "bridges/fpga_managed_stream.h"
+#include "core/simif.h"
+
+/**
+ * Platform replacing the FPGA with scripted in-memory models.
+ *
+ * The mock runs drivers on any Linux host, without an FPGA or an RTL
+ * simulator, in order to benchmark the host side of bridges and of the
+ * driver loop reproducibly. Since the mock knows nothing about the design,
+ * the models backing each register and stream are listed in a script passed
+ * through +mock-script=<file>, using the addresses of the generated header.
+ * Each line of the script holds one command, numbers being decimal or
+ * hexadecimal with a 0x prefix:
+ *
+ *   reg <addr> <value>          register holding the last value written
+ *   const <addr> <value>        register ignoring writes (ex. INIT_DONE)
+ *   pulse <addr> <period>       register reading 1 once every <period> reads
+ *                               (ex. an autocounter's countersready)
+ *   step <step> <done> <ns>     peek-poke stepping: a write of n to <step>
+ *                               runs the target for n cycles of <ns>, after
+ *                               which <done> reads as 1
+ *   tcycle <latch> <lo> <hi>    target cycle counter, latched on writes
+ *   hcycle <latch> <lo> <hi> <mhz>  host cycle counter at <mhz>
+ *   to-cpu <count> <dma> <capacity> <rate> [<word>]
+ *                               CPU-managed stream to the host, into which
+ *                               the target enqueues <rate> beats per cycle
+ *                               filled with a repeated 32-bit <word>
+ *   from-cpu <count> <dma> <capacity> <rate>
+ *                               CPU-managed stream from the host, from which
+ *                               the target dequeues <rate> beats per cycle
+ *   latency read|write|dma <ns> delay of MMIO reads, MMIO writes and stream
+ *                               beats, in nanoseconds
+ *   dram <bytes>                host-accessible DRAM of the given size
+ *
+ * Registers not listed in the script read back the last value written to
+ * them. The target only advances while all streams have room or data, so
+ * bridges which fall behind stall it as they would on an FPGA. Tokens are
+ * synthetic: a print stream of idle tokens is described with a word of
+ * `idle_cycles << 1`, while MMIO-based bridges such as autocounters and FASED
+ * models are described by their registers.
+ *
+ * Given the generated header of the design through
+ * +mock-header=<FireSim-generated.const.h>, numbers can also be named
+ * symbolically, which lets scripts outlive changes to the address map:
+ *
+ *   <WIDGET>_<i>.<REG>          address of a register of the i-th widget with
+ *                               a <WIDGET>_struct, or of the first one if
+ *                               _<i> is omitted (ex. PEEKPOKEBRIDGEMODULE.STEP)
+ *   <stream>.count|dma|capacity  parameters of a CPU-managed stream
+ */
+class simif_mock_t final : public simif_t, public BiDirectionalManagedStreamIO {
+public:
+  simif_mock_t(const TargetConfig &config,
+               const std::vector<std::string> &args);
+
+  void write(size_t addr, uint32_t data) override;
+  uint32_t read(size_t addr) override;
+
+  bool write_dram(uint64_t addr, const uint8_t *data, size_t size) override;
+  bool read_dram(uint64_t addr, uint8_t *data, size_t size) override;
+
+  CPUManagedStreamIO &get_cpu_managed_stream_io() override { return *this; }
+  FPGAManagedStreamIO &get_fpga_managed_stream_io() override { return *this; }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  uint32_t mmio_read(size_t addr) override { return read(addr); }
+  void mmio_write(size_t addr, uint32_t value) override {
+    return write(addr, value);
+  }
+  size_t
+  cpu_managed_axi4_write(size_t addr, const char *data, size_t size) override;
+  size_t cpu_managed_axi4_read(size_t addr, char *data, size_t size) override;
+  uint64_t get_beat_bytes() const override {
+    return config.cpu_managed ? config.cpu_managed->beat_bytes() : 64;
+  }
+  char *get_memory_base() override { return fpga_managed_buffer.data(); }
+
+  void load_script(const std::string &path);
+  void load_symbols(const std::string &path);
+
+  /// Runs the target up to the current time.
+  void advance();
+
+  /// Busy-waits to model the latency of an access.
+  static void delay(std::chrono::nanoseconds latency);
+
+  enum class reg_kind_t {
+    STORAGE,
+    CONST,
+    PULSE,
+    STEP,
+    DONE,
+    LATCH,
+    COUNTER_LO,
+    COUNTER_HI,
+    STREAM_COUNT,
+  };
+
+  struct reg_t {
+    reg_kind_t kind = reg_kind_t::STORAGE;
+    uint32_t value = 0;
+    /// Period of pulses, or index of the counter or stream.
+    uint64_t param = 0;
+    uint64_t reads = 0;
+  };
+
+  struct counter_t {
+    bool host;
+    double mhz;
+    uint64_t latched = 0;
+  };
+
+  struct stream_t {
+    bool to_cpu;
+    size_t dma_addr;
+    double capacity;
+    /// Beats enqueued or dequeued by the target per cycle.
+    double rate;
+    /// Beats in the FPGA-side queue.
+    double occupancy = 0.0;
+    uint32_t word = 0;
+  };
+
+  /// Addresses and parameters named in the generated header.
+  std::unordered_map<std::string, uint64_t> symbols;
+
+  std::unordered_map<size_t, reg_t> regs;
+  std::vector<counter_t> counters;
+  std::vector<stream_t> streams;
+
+  /// Target state.
+  double ns_per_cycle = 1.0;
+  double target_cycle = 0.0;
+  double pending_cycles = 0.0;
+  clock::time_point start_time;
+  clock::time_point last_advance;
+
+  std::chrono::nanoseconds read_latency{0};
+  std::chrono::nanoseconds write_latency{0};
+  std::chrono::nanoseconds beat_latency{0};
+
+  std::vector<uint8_t> dram;
+  std::vector<char> fpga_managed_buffer;
+};
+
+simif_mock_t::simif_mock_t(const TargetConfig &config,
+                           const std::vector<std::string> &args)
+    : simif_t(config) {
+  std::string script, header;
+  for (auto &arg : args) {
+    if (arg.find("+mock-script=") == 0) {
+      script = arg.c_str() + 13;
+    }
+    if (arg.find("+mock-header=") == 0) {
+      header = arg.c_str() + 13;
+    }
+  }
+  if (script.empty()) {
+    fprintf(stderr, "The mock platform requires +mock-script=<file>\n");
+    abort();
+  }
+  if (!header.empty()) {
+    load_symbols(header);
+  }
+  load_script(script);
+
+  if (config.fpga_managed) {
+    fpga_managed_buffer.resize(1 << 20);
+  }
+  start_time = last_advance = clock::now();
+}
+
+void simif_mock_t::load_script(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    fprintf(stderr, "Cannot open mock script: %s\n", path.c_str());
+    abort();
+  }
+
+  std::string line;
+  size_t lineno = 1;
+  auto num = [&](const std::string &s) -> uint64_t {
+    if (isdigit(s[0])) {
+      return strtoull(s.c_str(), 0, 0);
+    }
+    auto it = symbols.find(s);
+    if (it == symbols.end()) {
+      fprintf(stderr,
+              "%s:%zu: unknown symbol %s\n",
+              path.c_str(),
+              lineno,
+              s.c_str());
+      abort();
+    }
+    return it->second;
+  };
+
+  for (; std::getline(file, line); ++lineno) {
+    std::istringstream in(line);
+    std::vector<std::string> w;
+    for (std::string word; in >> word && word[0] != '#';) {
+      w.push_back(word);
+    }
+    if (w.empty()) {
+      continue;
+    }
+
+    auto &cmd = w[0];
+    const size_t n = w.size();
+    if (cmd == "reg" && n == 3) {
+      regs[num(w[1])] = {reg_kind_t::STORAGE, (uint32_t)num(w[2])};
+    } else if (cmd == "const" && n == 3) {
+      regs[num(w[1])] = {reg_kind_t::CONST, (uint32_t)num(w[2])};
+    } else if (cmd == "pulse" && n == 3) {
+      const uint64_t period = std::max<uint64_t>(num(w[2]), 1);
+      regs[num(w[1])] = {reg_kind_t::PULSE, 0, period};
+    } else if (cmd == "step" && n == 4) {
+      regs[num(w[1])] = {reg_kind_t::STEP};
+      regs[num(w[2])] = {reg_kind_t::DONE};
+      ns_per_cycle = atof(w[3].c_str());
+    } else if ((cmd == "tcycle" && n == 4) || (cmd == "hcycle" && n == 5)) {
+      const uint64_t index = counters.size();
+      counters.push_back({cmd == "hcycle", n == 5 ? atof(w[4].c_str()) : 0});
+      regs[num(w[1])] = {reg_kind_t::LATCH, 0, index};
+      regs[num(w[2])] = {reg_kind_t::COUNTER_LO, 0, index};
+      regs[num(w[3])] = {reg_kind_t::COUNTER_HI, 0, index};
+    } else if ((cmd == "to-cpu" && (n == 5 || n == 6)) ||
+               (cmd == "from-cpu" && n == 5)) {
+      stream_t stream;
+      stream.to_cpu = cmd == "to-cpu";
+      stream.dma_addr = num(w[2]);
+      stream.capacity = num(w[3]);
+      stream.rate = atof(w[4].c_str());
+      stream.word = n == 6 ? num(w[5]) : 0;
+      regs[num(w[1])] = {reg_kind_t::STREAM_COUNT, 0, streams.size()};
+      streams.push_back(stream);
+    } else if (cmd == "latency" && n == 3) {
+      std::chrono::nanoseconds latency(num(w[2]));
+      if (w[1] == "read") {
+        read_latency = latency;
+      } else if (w[1] == "write") {
+        write_latency = latency;
+      } else if (w[1] == "dma") {
+        beat_latency = latency;
+      } else {
+        fprintf(stderr, "%s:%zu: unknown latency\n", path.c_str(), lineno);
+        abort();
+      }
+    } else if (cmd == "dram" && n == 2) {
+      dram.resize(num(w[1]));
+    } else {
+      fprintf(stderr, "%s:%zu: malformed command\n", path.c_str(), lineno);
+      abort();
+    }
+  }
+}
+
+void simif_mock_t::load_symbols(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    fprintf(stderr, "Cannot open generated header: %s\n", path.c_str());
+    abort();
+  }
+
+  auto next_line = [&](std::string &line) {
+    if (!std::getline(file, line)) {
+      return false;
+    }
+    line.erase(0, std::min(line.find_first_not_of(" \t"), line.size()));
+    return true;
+  };
+  auto ends_with = [](const std::string &s, std::string_view suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+
+  // Widget registers are listed in the constructor calls of the header, one
+  // per line, within a `<WIDGET>_struct{` initializer. CPU-managed streams are
+  // described by a StreamParameters call, holding one argument per line: the
+  // name of the stream, its DMA address, the address of its count register
+  // and its capacity.
+  std::unordered_map<std::string, size_t> instances;
+  std::string line;
+  while (next_line(line)) {
+    if (ends_with(line, "_struct{")) {
+      const std::string widget = line.substr(0, line.size() - 8);
+      const size_t index = instances[widget]++;
+      while (next_line(line) && line[0] == '.') {
+        const auto eq = line.find(" = ");
+        if (eq == std::string::npos) {
+          break;
+        }
+        const std::string field = line.substr(1, eq - 1);
+        const uint64_t value = strtoull(line.c_str() + eq + 3, 0, 0);
+        symbols[widget + "_" + std::to_string(index) + "." + field] = value;
+        if (index == 0) {
+          symbols[widget + "." + field] = value;
+        }
+      }
+    } else if (ends_with(line, "CPUManagedStreams::StreamParameters(")) {
+      std::string name, dma, count, capacity;
+      if (!next_line(name) || !next_line(dma) || !next_line(count) ||
+          !next_line(capacity)) {
+        break;
+      }
+      const auto open = name.find("ESC(");
+      const auto close = name.rfind(")ESC");
+      if (open == std::string::npos || close == std::string::npos) {
+        continue;
+      }
+      name = name.substr(open + 4, close - open - 4);
+      symbols[name + ".dma"] = strtoull(dma.c_str(), 0, 0);
+      symbols[name + ".count"] = strtoull(count.c_str(), 0, 0);
+      symbols[name + ".capacity"] = strtoull(capacity.c_str(), 0, 0);
+    }
+  }
+}
+
+void simif_mock_t::delay(std::chrono::nanoseconds latency) {
+  if (latency.count() == 0) {
+    return;
+  }
+  const auto end = clock::now() + latency;
+  while (clock::now() < end)
+    ;
+}
+
+void simif_mock_t::advance() {
+  const auto now = clock::now();
+  const double elapsed =
+      std::chrono::duration<double, std::nano>(now - last_advance).count();
+  last_advance = now;
+  if (pending_cycles == 0.0) {
+    return;
+  }
+
+  // The target stalls once a stream to the host fills up or a stream from
+  // the host runs dry.
+  double cycles = std::min(pending_cycles, elapsed / ns_per_cycle);
+  for (auto &stream : streams) {
+    if (stream.rate <= 0.0) {
+      continue;
+    }
+    const double room =
+        stream.to_cpu ? stream.capacity - stream.occupancy : stream.occupancy;
+    cycles = std::min(cycles, room / stream.rate);
+  }
+  // Do not leave steps unfinished due to rounding.
+  if (pending_cycles - cycles < 1e-6) {
+    cycles = pending_cycles;
+  }
+
+  for (auto &stream : streams) {
+    stream.occupancy += (stream.to_cpu ? 1 : -1) * cycles * stream.rate;
+    stream.occupancy = std::clamp(stream.occupancy, 0.0, stream.capacity);
+  }
+  target_cycle += cycles;
+  pending_cycles -= cycles;
+}
+
+void simif_mock_t::write(size_t addr, uint32_t data) {
+  delay(write_latency);
+  auto &reg = regs[addr];
+  switch (reg.kind) {
+  case reg_kind_t::STORAGE:
+    reg.value = data;
+    break;
+  case reg_kind_t::STEP:
+    advance();
+    pending_cycles += data;
+    break;
+  case reg_kind_t::LATCH: {
+    advance();
+    auto &counter = counters[reg.param];
+    if (counter.host) {
+      const std::chrono::duration<double, std::micro> elapsed =
+          clock::now() - start_time;
+      counter.latched = elapsed.count() * counter.mhz;
+    } else {
+      counter.latched = target_cycle + 1e-6;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+uint32_t simif_mock_t::read(size_t addr) {
+  delay(read_latency);
+  auto &reg = regs[addr];
+  switch (reg.kind) {
+  case reg_kind_t::STORAGE:
+  case reg_kind_t::CONST:
+    return reg.value;
+  case reg_kind_t::PULSE:
+    return ++reg.reads % reg.param == 0;
+  case reg_kind_t::DONE:
+    advance();
+    return pending_cycles == 0.0;
+  case reg_kind_t::COUNTER_LO:
+    return counters[reg.param].latched;
+  case reg_kind_t::COUNTER_HI:
+    return counters[reg.param].latched >> 32;
+  case reg_kind_t::STREAM_COUNT:
+    advance();
+    return streams[reg.param].occupancy;
+  default:
+    return 0;
+  }
+}
+
+size_t
+simif_mock_t::cpu_managed_axi4_read(size_t addr, char *data, size_t size) {
+  auto it = std::find_if(streams.begin(), streams.end(), [&](auto &s) {
+    return s.to_cpu && s.dma_addr == addr;
+  });
+  assert(it != streams.end() && "read from unknown stream");
+
+  const size_t beats = size / get_beat_bytes();
+  assert(beats <= it->occupancy && "read past the end of the stream");
+  delay(beat_latency * beats);
+  it->occupancy -= beats;
+  for (size_t i = 0; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+    memcpy(data + i, &it->word, sizeof(uint32_t));
+  }
+  return size;
+}
+
+size_t simif_mock_t::cpu_managed_axi4_write(size_t addr,
+                                            const char *data,
+                                            size_t size) {
+  auto it = std::find_if(streams.begin(), streams.end(), [&](auto &s) {
+    return !s.to_cpu && s.dma_addr == addr;
+  });
+  assert(it != streams.end() && "write to unknown stream");
+
+  const size_t beats = size / get_beat_bytes();
+  assert(it->occupancy + beats <= it->capacity && "stream overflow");
+  delay(beat_latency * beats);
+  it->occupancy += beats;
+  return size;
+}
+
+bool simif_mock_t::write_dram(uint64_t addr, const uint8_t *data, size_t size) {
+  if (addr + size > dram.size()) {
+    return false;
+  }
+  memcpy(dram.data() + addr, data, size);
+  return true;
+}
+
+bool simif_mock_t::read_dram(uint64_t addr, uint8_t *data, size_t size) {
+  if (addr + size > dram.size()) {
+    return false;
+  }
+  memcpy(data, dram.data() + addr, size);
+  return true;
+}
+
+std::unique_ptr<simif_t>
+create_simif(const TargetConfig &config, int argc, char **argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  return std::make_unique<simif_mock_t>(config, args);
+}
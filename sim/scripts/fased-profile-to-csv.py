@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+
+# Converts the binary profile written by a FASED memory timing model driver
+# (enabled with +mm_binaryProfile_<idx>) back to the CSV format of the
+# memory_stats<idx>.csv file.
+
+import argparse
+import struct
+import sys
+
+parser = argparse.ArgumentParser(
+  description = "Convert a binary FASED profile to CSV")
+parser.add_argument(
+  "input", type=str, help="binary profile written by the driver")
+parser.add_argument(
+  "-o", "--output", dest="output", type=str, help="output CSV file (default: stdout)")
+parser.add_argument(
+  "-a", "--all", dest="all", action="store_true",
+  help="also emit the timestamp and address range counter columns")
+parser.add_argument(
+  "-d", "--deltas", dest="deltas", action="store_true",
+  help="emit the difference between consecutive samples instead of raw values")
+
+args = parser.parse_args()
+
+formats = { 4: "I", 8: "Q" }
+
+with open(args.input, "rb") as f:
+  data = f.read()
+
+offset = 0
+def unpack(fmt):
+  global offset
+  values = struct.unpack_from("=" + fmt, data, offset)
+  offset += struct.calcsize("=" + fmt)
+  return values
+
+if data[:8] != b"FASEDPRF":
+  sys.exit("%s: not a FASED binary profile" % args.input)
+offset = 8
+version, ncolumns = unpack("II")
+if version != 1:
+  sys.exit("%s: unsupported profile version %d" % (args.input, version))
+
+columns = []
+for _ in range(ncolumns):
+  (length,) = unpack("I")
+  name = data[offset:offset + length].decode()
+  offset += length
+  (width,) = unpack("B")
+  columns.append((name, width))
+
+# The first column holds timestamps, followed by the profiled registers and
+# then by the address range counters, which are all named "*Ranges_<i>".
+def selected(index, name):
+  if args.all:
+    return True
+  return index != 0 and "Ranges_" not in name
+
+selection = [i for i, (name, _) in enumerate(columns) if selected(i, name)]
+
+out = open(args.output, "w") if args.output else sys.stdout
+out.write("".join(columns[i][0] + "," for i in selection) + "\n")
+
+last = None
+while offset < len(data):
+  (rows,) = unpack("I")
+  values = [unpack(str(rows) + formats[width]) for _, width in columns]
+  for row in range(rows):
+    sample = [values[i][row] for i in selection]
+    if args.deltas:
+      previous = last if last is not None else [0] * len(sample)
+      last = sample
+      sample = [v - p for v, p in zip(sample, previous)]
+    out.write("".join(str(v) + "," for v in sample) + "\n")
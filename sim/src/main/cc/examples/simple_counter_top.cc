@@ -23,6 +23,8 @@ private:
   simif_t &simif;
   /// Reference to the peek-poke bridge.
   peek_poke_t &peek_poke;
+  /// Reference to the clock bridge, which caches the time for bridges.
+  clockmodule_t &clock;
   /// Flag to indicate that the simulation was terminated.
   bool terminated = false;
 };
@@ -31,10 +33,10 @@ simple_counter_top_t::simple_counter_top_t(simif_t &simif,
                              widget_registry_t &registry,
                              const std::vector<std::string> &args)
     : systematic_scheduler_t(args), simulation_t(registry, args), simif(simif),
-      peek_poke(registry.get_widget<peek_poke_t>()) {
+      peek_poke(registry.get_widget<peek_poke_t>()),
+      clock(registry.get_widget<clockmodule_t>()) {
   // helper to verify that simulation is running
-  registry.add_widget(
-      new heartbeat_t(simif, registry.get_widget<clockmodule_t>(), args));
+  registry.add_widget(new heartbeat_t(simif, clock, args));
 }
 
 // DOC include start: Loop
@@ -46,9 +48,11 @@ int simple_counter_top_t::simulation_run() {
     peek_poke.step(get_largest_stepsize(), false);
     // while the simulation is running N cycles, run all simulation bridges
     while (!peek_poke.is_done() && !terminated) {
+      // let bridges share one sample of the time per iteration
+      clock.next_iteration();
       for (auto *bridge : registry.get_all_bridges()) {
 	// do bridge work
-        bridge->tick();
+        tick_bridge(*bridge);
 	// if a bridge has finished then fully exit
         if (bridge->terminate()) {
           exit_code = bridge->exit_code();
@@ -5,9 +5,13 @@
 #include "bridges/peek_poke.h"
 #include "bridges/reset_pulse.h"
 #include "core/bridge_driver.h"
+#include "core/output_file.h"
 #include "core/simulation.h"
 #include "core/systematic_scheduler.h"
 
+#include <fstream>
+#include <sstream>
+
 class fasedtests_top_t : public systematic_scheduler_t, public simulation_t {
 public:
   fasedtests_top_t(simif_t &simif,
@@ -19,8 +23,29 @@ public:
   bool simulation_timed_out() override { return !done; }
 
 private:
+  /// Advances the target until it reports it is done or the cycle limit
+  /// is reached. The done flag is ignored before the given target cycle.
+  void run_until_done(uint64_t ignore_done_until = 0);
+
+  /// Completes the step issued to the peek-poke bridge, if any, leaving the
+  /// target paused.
+  void drain_step();
+
+  /// Runs the target once for each configuration of the sweep file.
+  int run_sweep();
+
+  /// Reads the uarch event registers validated through +expect_ plusargs.
+  std::vector<std::unordered_map<std::string, uint32_t>> read_events();
+
+  /// Checks that the events counted since `baseline` match the expected
+  /// values. Without a baseline, the values of the registers are checked.
+  bool check_events(
+      const std::vector<std::unordered_map<std::string, uint32_t>> *baseline);
+
   /// Reference to the simulation interface.
   simif_t &simif;
+  /// Reference to the clock bridge.
+  clockmodule_t &clock;
   /// Reference to the peek-poke bridge.
   peek_poke_t &peek_poke;
   /// List of models in the design.
@@ -29,12 +54,22 @@ private:
   std::unordered_map<std::string, uint32_t> expected_uarchevent_values;
   /// Flag to indicating that the target reported it is done.
   bool done = false;
+  /// Set while a step issued to the peek-poke bridge has not completed.
+  bool stepping = false;
+
+  /// FASED configurations to run in batch mode, one per line of the file
+  /// passed through +fased-sweep=<file>. Each line holds a list of +mm_
+  /// plusargs overriding those passed on the command line.
+  std::vector<std::string> sweep_points;
+  /// File collecting the statistics of all sweep points.
+  std::string sweep_results_filename = "fased-sweep.csv";
 };
 
 fasedtests_top_t::fasedtests_top_t(simif_t &simif,
                                    widget_registry_t &registry,
                                    const std::vector<std::string> &args)
     : systematic_scheduler_t(args), simulation_t(registry, args), simif(simif),
+      clock(registry.get_widget<clockmodule_t>()),
       peek_poke(registry.get_widget<peek_poke_t>()),
       models(registry.get_bridges<FASEDMemoryTimingModel>()) {
 
@@ -45,6 +80,28 @@ fasedtests_top_t::fasedtests_top_t(simif_t &simif,
       profile_interval = atoi(arg.c_str() + 18);
       continue;
     }
+    if (arg.find("+fased-sweep=") == 0) {
+      std::string sweep_filename(arg.c_str() + 13);
+      std::ifstream sweep_file(sweep_filename);
+      if (!sweep_file.is_open()) {
+        throw std::runtime_error("Could not open sweep file: " +
+                                 sweep_filename);
+      }
+      std::string line;
+      while (std::getline(sweep_file, line)) {
+        // Skip blank lines and comments.
+        auto start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') {
+          continue;
+        }
+        sweep_points.push_back(line.substr(start));
+      }
+      continue;
+    }
+    if (arg.find("+fased-sweep-results=") == 0) {
+      sweep_results_filename = std::string(arg.c_str() + 21);
+      continue;
+    }
     if (arg.find("+expect_") == 0) {
       auto sub_arg = std::string(arg.c_str() + 8);
       size_t delimit_idx = sub_arg.find_first_of("=");
@@ -57,37 +114,90 @@ fasedtests_top_t::fasedtests_top_t(simif_t &simif,
 
   // Add functions you'd like to periodically invoke on a paused simulator here.
   if (profile_interval) {
-    register_task(0, [&] {
-      for (auto *mod : registry.get_bridges<FASEDMemoryTimingModel>()) {
-        mod->profile();
+    const uint64_t interval = *profile_interval;
+    register_task(0, [this, interval, cycle = uint64_t(0)]() mutable {
+      // Models are only profiled in the detailed phases of the simulation.
+      if (!phases || phases->detailed(cycle)) {
+        for (auto *mod : models) {
+          mod->profile();
+        }
       }
-      return *profile_interval;
+      cycle += interval;
+      return interval;
     });
   }
 }
 
-int fasedtests_top_t::simulation_run() {
+void fasedtests_top_t::run_until_done(uint64_t ignore_done_until) {
   // Run the simulation until the target reports it is finished by setting
-  // the done output flag or the desired number of cycles completes.
+  // the done output flag or the desired number of cycles completes. If the
+  // target finished in the middle of a step, the step is resumed on the
+  // next call instead of issuing a new one.
+  done = false;
   while (!done && !finished_scheduled_tasks()) {
-    run_scheduled_tasks();
-    peek_poke.step(get_largest_stepsize(), false);
-    while (!peek_poke.is_done() && !done) {
+    if (!stepping) {
+      run_scheduled_tasks();
+      peek_poke.step(get_largest_stepsize(), false);
+      stepping = true;
+    }
+    while (!done) {
+      if (peek_poke.is_done()) {
+        stepping = false;
+        break;
+      }
+      clock.next_iteration();
       for (auto *bridge : registry.get_all_bridges()) {
-        bridge->tick();
+        tick_bridge(*bridge);
+      }
+      if (ignore_done_until != 0) {
+        if (clock.cached_tcycle() < ignore_done_until) {
+          continue;
+        }
+        ignore_done_until = 0;
       }
       if (peek_poke.sample_value("done")) {
         done = true;
-        break;
       }
     }
   }
+}
+
+void fasedtests_top_t::drain_step() {
+  while (stepping) {
+    if (peek_poke.is_done()) {
+      stepping = false;
+      break;
+    }
+    clock.next_iteration();
+    for (auto *bridge : registry.get_all_bridges()) {
+      tick_bridge(*bridge);
+    }
+  }
+}
 
+std::vector<std::unordered_map<std::string, uint32_t>>
+fasedtests_top_t::read_events() {
+  std::vector<std::unordered_map<std::string, uint32_t>> events;
+  for (auto *model : models) {
+    auto &values = events.emplace_back();
+    for (auto &[key, value] : expected_uarchevent_values) {
+      values[key] = simif.read(model->get_addr_map().r_addr(key));
+    }
+  }
+  return events;
+}
+
+bool fasedtests_top_t::check_events(
+    const std::vector<std::unordered_map<std::string, uint32_t>> *baseline) {
   // Iterate through all uarch values we want to validate.
   bool failed = false;
-  for (auto &model : models) {
+  const auto events = read_events();
+  for (size_t i = 0; i < events.size(); i++) {
     for (auto &[key, value] : expected_uarchevent_values) {
-      auto actual_value = simif.read(model->get_addr_map().r_addr(key));
+      uint32_t actual_value = events[i].at(key);
+      if (baseline) {
+        actual_value -= (*baseline)[i].at(key);
+      }
       if (actual_value != value) {
         fprintf(stderr,
                 "FASED Test Harness -- %s did not match: Measured %d, Expected "
@@ -99,8 +209,102 @@ int fasedtests_top_t::simulation_run() {
       }
     }
   }
+  return !failed;
+}
+
+int fasedtests_top_t::run_sweep() {
+  auto resets = registry.get_bridges<reset_pulse_t>();
+  if (resets.size() != 1) {
+    throw std::runtime_error("FASED sweeps require a single reset bridge");
+  }
+  auto &reset = *resets[0];
+
+  output_file_t results(sweep_results_filename);
+  if (!results.is_open()) {
+    throw std::runtime_error("Could not open sweep results file: " +
+                             sweep_results_filename);
+  }
+  results << "point,configuration,done,cycles";
+  for (size_t i = 0; i < models.size(); i++) {
+    for (auto &name : models[i]->get_profile_register_names()) {
+      results << "," << name << "_" << i;
+    }
+  }
+  results << std::endl;
+
+  // Each point starts from the same state: the previous step is drained so
+  // that the models are idle, DRAM is zeroed out and the image rewritten,
+  // then the models are re-programmed and the target is reset before it runs
+  // to completion again. Counters are not reset, so the statistics of a point
+  // are the differences of the instrumentation registers before and after
+  // it ran, which are also checked against +expect_ plusargs.
+  bool all_done = true;
+  bool all_passed = true;
+  for (size_t point = 0; point < sweep_points.size(); point++) {
+    std::vector<std::string> point_args;
+    std::istringstream tokens(sweep_points[point]);
+    for (std::string token; tokens >> token;) {
+      point_args.push_back(token);
+    }
+
+    drain_step();
+    reinit_dram();
+    for (auto *model : models) {
+      model->reprogram(point_args);
+    }
+    // The target comes out of reset on its own before the first point.
+    // Afterwards, the done flag of the previous point stays set until the
+    // new reset pulse has gone through. The target is paused, so the pulse
+    // ends a fixed number of cycles from now.
+    uint64_t reset_end = 0;
+    if (point != 0) {
+      reset.pulse();
+      reset_end = clock.tcycle() + reset.get_pulse_length() + 1;
+    }
+
+    std::vector<std::vector<uint32_t>> before;
+    for (auto *model : models) {
+      before.push_back(model->read_profile_registers());
+    }
+    const uint64_t start_cycle = clock.tcycle();
+
+    const auto events = read_events();
+    run_until_done(reset_end);
+    all_done &= done;
+    const bool passed = check_events(&events);
+    all_passed &= passed;
+
+    results << point << ",\"" << sweep_points[point] << "\"," << done << ","
+            << clock.tcycle() - start_cycle;
+    for (size_t i = 0; i < models.size(); i++) {
+      auto &after = models[i]->read_profile_registers();
+      for (size_t j = 0; j < after.size(); j++) {
+        results << "," << (uint32_t)(after[j] - before[i][j]);
+      }
+    }
+    results << std::endl;
+
+    fprintf(stderr,
+            "FASED sweep point %zu of %zu %s\n",
+            point + 1,
+            sweep_points.size(),
+            !done ? "timed out" : passed ? "completed" : "failed");
+    if (!done) {
+      break;
+    }
+  }
+
+  done = all_done;
+  return all_passed ? 0 : 1;
+}
+
+int fasedtests_top_t::simulation_run() {
+  if (!sweep_points.empty()) {
+    return run_sweep();
+  }
 
-  return failed ? 1 : 0;
+  run_until_done();
+  return check_events(nullptr) ? 0 : 1;
 }
 
 std::unique_ptr<simulation_t>
@@ -0,0 +1,85 @@
+// See LICENSE for license details.
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "StimulusTrace.h"
+
+StimulusTrace StimulusTrace::load(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << "Cannot open stimulus trace " << path << std::endl;
+    abort();
+  }
+
+  StimulusTrace trace;
+  std::string line;
+  for (size_t lineno = 1; std::getline(file, line); ++lineno) {
+    std::istringstream in(line);
+    std::string kind, port, value;
+    uint64_t cycle;
+    in >> std::ws;
+    if (in.eof() || in.peek() == '#') {
+      continue;
+    }
+    if (!(in >> cycle >> kind >> port >> value) ||
+        (kind != "poke" && kind != "expect")) {
+      std::cerr << path << ":" << lineno << ": malformed event: " << line
+                << std::endl;
+      abort();
+    }
+
+    if (value.rfind("0x", 0) == 0) {
+      value.erase(0, 2);
+    }
+    mpz_t v;
+    if (mpz_init_set_str(v, value.c_str(), 16) != 0) {
+      std::cerr << path << ":" << lineno << ": malformed value: " << value
+                << std::endl;
+      abort();
+    }
+    if (mpz_sizeinbase(v, 2) <= 32) {
+      uint32_t narrow = mpz_get_ui(v);
+      if (kind == "poke") {
+        trace.poke(cycle, std::move(port), narrow);
+      } else {
+        trace.expect(cycle, std::move(port), narrow);
+      }
+    } else {
+      if (kind == "poke") {
+        trace.poke(cycle, std::move(port), v);
+      } else {
+        trace.expect(cycle, std::move(port), v);
+      }
+    }
+    mpz_clear(v);
+  }
+  return trace;
+}
+
+std::vector<const StimulusTrace::Event *>
+StimulusTrace::sorted_events() const {
+  std::vector<const Event *> sorted;
+  sorted.reserve(events.size());
+  for (auto &event : events) {
+    sorted.push_back(&event);
+  }
+  // Expects observe the outputs before the pokes of the same cycle.
+  std::stable_sort(
+      sorted.begin(), sorted.end(), [](const Event *a, const Event *b) {
+        return std::make_pair(a->cycle, a->kind == Kind::POKE) <
+               std::make_pair(b->cycle, b->kind == Kind::POKE);
+      });
+  return sorted;
+}
+
+void StimulusTrace::add_wide(uint64_t cycle,
+                             Kind kind,
+                             std::string port,
+                             mpz_t &value) {
+  std::unique_ptr<char[]> str(mpz_get_str(nullptr, 16, value));
+  events.push_back({cycle, kind, std::move(port), 0, str.get()});
+}
@@ -0,0 +1,71 @@
+// See LICENSE for license details.
+
+#ifndef MIDASEXAMPLES_STIMULUSTRACE_H
+#define MIDASEXAMPLES_STIMULUSTRACE_H
+
+#include <cstdint>
+#include <gmp.h>
+#include <string>
+#include <vector>
+
+/**
+ * Precomputed stimulus for the top-level ports of a design: values to poke
+ * into inputs and values expected on outputs, keyed by cycle.
+ *
+ * Traces are either built in C++, typically from a golden model, or loaded
+ * from text files generated offline, holding one event per line:
+ *
+ *   <cycle> poke <port> <hex value>
+ *   <cycle> expect <port> <hex value>
+ *
+ * Blank lines and lines starting with '#' are ignored. Cycles are relative to
+ * the start of the replay and events need not be sorted. At a given cycle,
+ * outputs are checked against the expected values before the pokes of that
+ * cycle are applied: a poke at cycle N is observed by expects at cycle N + 1.
+ */
+class StimulusTrace {
+public:
+  enum class Kind { POKE, EXPECT };
+
+  struct Event {
+    uint64_t cycle;
+    Kind kind;
+    std::string port;
+    /// Value of the event, if it fits in 32 bits.
+    uint32_t value;
+    /// Hexadecimal value of the event if it is wider than 32 bits, or empty.
+    std::string wide;
+  };
+
+  /**
+   * Loads a trace from a text file, aborting if it is malformed.
+   */
+  static StimulusTrace load(const std::string &path);
+
+  void poke(uint64_t cycle, std::string port, uint32_t value) {
+    events.push_back({cycle, Kind::POKE, std::move(port), value, {}});
+  }
+  void poke(uint64_t cycle, std::string port, mpz_t &value) {
+    add_wide(cycle, Kind::POKE, std::move(port), value);
+  }
+
+  void expect(uint64_t cycle, std::string port, uint32_t value) {
+    events.push_back({cycle, Kind::EXPECT, std::move(port), value, {}});
+  }
+  void expect(uint64_t cycle, std::string port, mpz_t &value) {
+    add_wide(cycle, Kind::EXPECT, std::move(port), value);
+  }
+
+  /**
+   * Returns the events of the trace, sorted by cycle. Events of the same kind
+   * at the same cycle are kept in insertion order.
+   */
+  std::vector<const Event *> sorted_events() const;
+
+private:
+  void add_wide(uint64_t cycle, Kind kind, std::string port, mpz_t &value);
+
+  std::vector<Event> events;
+};
+
+#endif // MIDASEXAMPLES_STIMULUSTRACE_H
@@ -1,5 +1,9 @@
 #include <cinttypes>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #include "TestHarness.h"
 
@@ -141,6 +145,119 @@ bool TestHarness::expect(std::string_view id, mpz_t &expected) {
   return expect(pass, nullptr);
 }
 
+bool TestHarness::replay(const StimulusTrace &trace) {
+  const uint64_t start = t;
+  size_t checked = 0, mismatches = 0, unstable = 0;
+
+  // Resolve the port of each event once, ahead of the replay, so that steps
+  // do not look up ports by name.
+  const auto events = trace.sorted_events();
+  std::unordered_map<std::string_view, peek_poke_t::InputHandle> inputs;
+  std::unordered_map<std::string_view, peek_poke_t::OutputHandle> outputs;
+  std::vector<peek_poke_t::InputHandle> poke_ports(events.size());
+  std::vector<peek_poke_t::OutputHandle> expect_ports(events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    const std::string_view port = events[i]->port;
+    if (events[i]->kind == StimulusTrace::Kind::POKE) {
+      auto it = inputs.find(port);
+      if (it == inputs.end()) {
+        it = inputs.emplace(port, peek_poke.input(port)).first;
+      }
+      poke_ports[i] = it->second;
+    } else {
+      auto it = outputs.find(port);
+      if (it == outputs.end()) {
+        it = outputs.emplace(port, peek_poke.output(port)).first;
+      }
+      expect_ports[i] = it->second;
+    }
+  }
+
+  // Last value driven onto each narrow input, by port.
+  std::unordered_map<const peek_poke_t::Port *, uint32_t> driven;
+
+  mpz_t value, expected;
+  mpz_init(value);
+  mpz_init(expected);
+  for (size_t i = 0; i < events.size(); i++) {
+    const auto *event = events[i];
+    // Advance to the cycle of the event in as few steps as possible.
+    while (t < start + event->cycle) {
+      const uint64_t n = std::min<uint64_t>(
+          start + event->cycle - t, std::numeric_limits<uint32_t>::max());
+      peek_poke.step(n, true);
+      t += n;
+    }
+
+    if (event->kind == StimulusTrace::Kind::POKE) {
+      const auto port = poke_ports[i];
+      if (!event->wide.empty()) {
+        mpz_set_str(value, event->wide.c_str(), 16);
+        peek_poke.poke(port, value);
+        driven.erase(port.port);
+        continue;
+      }
+      auto it = driven.find(port.port);
+      if (it != driven.end() && it->second == event->value) {
+        continue;
+      }
+      peek_poke.poke(port, event->value, true);
+      driven[port.port] = event->value;
+    } else {
+      std::string got, want;
+      if (!event->wide.empty()) {
+        mpz_set_str(expected, event->wide.c_str(), 16);
+        peek_poke.peek(expect_ports[i], value);
+        if (mpz_cmp(value, expected) != 0) {
+          std::unique_ptr<char[]> v_str(mpz_get_str(nullptr, 16, value));
+          got = v_str.get();
+          want = event->wide;
+        }
+      } else {
+        uint32_t v = peek_poke.peek(expect_ports[i], true);
+        if (v != event->value) {
+          std::ostringstream v_str, e_str;
+          v_str << std::hex << v;
+          e_str << std::hex << event->value;
+          got = v_str.str();
+          want = e_str.str();
+        }
+      }
+      unstable += peek_poke.unstable();
+      checked++;
+
+      if (!got.empty()) {
+        if (mismatches < max_reported_mismatches) {
+          std::cerr << "* MISMATCH at cycle " << t << ": " << target_name
+                    << "." << event->port << " -> 0x" << got << " != 0x"
+                    << want << " *" << std::endl;
+        }
+        mismatches++;
+        expect(false, nullptr);
+      }
+    }
+
+    if (peek_poke.timeout()) {
+      std::cerr << "* FAIL : replay on " << target_name << "." << event->port
+                << " has timed out. " << blocking_fail << " : FAIL"
+                << std::endl;
+      expect(false, nullptr);
+      break;
+    }
+  }
+  mpz_clear(value);
+  mpz_clear(expected);
+
+  std::cerr << "* REPLAY " << std::dec << (checked - mismatches) << "/"
+            << checked << " expects passed over " << (t - start)
+            << " cycles";
+  if (unstable) {
+    std::cerr << ", " << unstable << " on unstable values";
+  }
+  std::cerr << " *" << std::endl;
+  return mismatches == 0;
+}
+
 int TestHarness::teardown() {
   std::cerr << "[" << target_name << "]";
   std::cerr << (pass ? "PASS" : "FAIL") << " Test";
@@ -3,6 +3,7 @@
 
 #include <random>
 
+#include "StimulusTrace.h"
 #include "bridges/peek_poke.h"
 #include "core/simif.h"
 #include "core/simulation.h"
@@ -54,6 +55,20 @@ public:
   bool expect(std::string_view id, mpz_t &expected);
   bool expect(bool pass, const char *s);
 
+  /**
+   * Replays a stimulus trace starting at the current cycle.
+   *
+   * The target is stepped directly to the next cycle at which the trace
+   * pokes or expects a value, without logging individual accesses. Pokes of
+   * values already driven onto a port are skipped. Ports are resolved once,
+   * before the replay starts. Only mismatches and a summary are reported.
+   * Combined with +peek-poke-transactional, the pokes and the step request of
+   * each cycle are written in a single batch.
+   *
+   * @returns True if all expected values matched.
+   */
+  bool replay(const StimulusTrace &trace);
+
   int teardown();
 
   /**
@@ -82,6 +97,8 @@ protected:
 
   bool pass = true;
   bool log = true;
+  /// Number of mismatches reported in detail by a replay.
+  size_t max_reported_mismatches = 16;
 
   uint64_t t = 0;
   uint64_t fail_t = 0;
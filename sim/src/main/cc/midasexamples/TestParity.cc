@@ -4,19 +4,40 @@
 
 class TestParity final : public TestHarness {
 public:
-  using TestHarness::TestHarness;
+  TestParity(widget_registry_t &registry,
+             const std::vector<std::string> &args,
+             std::string_view target_name)
+      : TestHarness(registry, args, target_name) {
+    for (const auto &arg : args) {
+      if (arg.find("+stimulus-trace=") == 0) {
+        trace_path = arg.substr(16);
+      }
+    }
+  }
 
   void run_test() override {
+    // With +stimulus-trace=, replay a trace generated offline.
+    if (!trace_path.empty()) {
+      target_reset();
+      replay(StimulusTrace::load(trace_path));
+      return;
+    }
+
+    // Compute the stimulus from a golden model and replay it in one go.
+    StimulusTrace trace;
     uint32_t is_odd = 0;
-    target_reset();
     for (int i = 0; i < 64; i++) {
       uint32_t bit = random() % 2;
-      poke("io_in", bit);
-      step(1);
+      trace.poke(i, "io_in", bit);
       is_odd = (is_odd + bit) % 2;
-      expect("io_out", is_odd);
+      trace.expect(i + 1, "io_out", is_odd);
     }
+    target_reset();
+    replay(trace);
   }
+
+private:
+  std::string trace_path;
 };
 
 TEST_MAIN(TestParity)
@@ -91,6 +91,29 @@ public:
     case 0x11:
       mpz_set_str(e0, "1eadbeef", 16);
       break;
+    case 0x20:
+      mpz_set_str(
+          e0,
+          "7edcba98765432100123456789abcdeffffffffffffffffe8000000000000001",
+          16);
+      break;
+    case 0x21:
+      mpz_setbit(e0, 64);
+      break;
+    case 0x22:
+      mpz_setbit(e0, 128);
+      mpz_sub_ui(e0, e0, 1);
+      break;
+    case 0x23:
+      mpz_setbit(e0, 192);
+      break;
+    case 0x24:
+    case 0x25:
+    case 0x26:
+      // values passed from scala for 0x25 and 0x26 are too large, as above
+      mpz_setbit(e0, 255);
+      mpz_sub_ui(e0, e0, 1);
+      break;
 
     default:
     case -1:
@@ -0,0 +1,19 @@
+// See LICENSE for license details.
+
+#include "PrintfTest.h"
+
+class TestWidePrintfModule : public PrintTest {
+public:
+  using PrintTest::PrintTest;
+
+  void run_test() override {
+    poke("reset", 1);
+    poke("io_enable", 0);
+    step(1);
+    poke("reset", 0);
+    poke("io_enable", 1);
+    run_and_collect_prints(1024);
+  }
+};
+
+TEST_MAIN(TestWidePrintfModule)
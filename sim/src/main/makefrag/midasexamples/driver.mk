@@ -8,6 +8,7 @@ firesim_lib_dir = $(firesim_base_dir)/firesim-lib/src/main/cc/
 DRIVER_H = $(shell find $(driver_dir) -name "*.h")
 DRIVER_CC := \
 		$(driver_dir)/midasexamples/TestHarness.cc \
+		$(driver_dir)/midasexamples/StimulusTrace.cc \
 		$(driver_dir)/midasexamples/Test$(DESIGN).cc
 
 TARGET_CXX_FLAGS := \
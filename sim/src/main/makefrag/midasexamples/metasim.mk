@@ -36,3 +36,14 @@ run-vcs run-vcs-post-synth run-vcs-debug run-vcs-post-synth-debug: run-vcs%: $(G
 		$(loadmem) \
 		$(if $(findstring debug,$@),+fsdbfile=$(call waveform,vcs$(<:$(GENERATED_DIR)/$(DESIGN)%=%),fsdb),) \
 		2> $(call logfile,vcs$(<:$(GENERATED_DIR)/$(DESIGN)%=%))
+
+# Runs the driver against the mock platform, with the script of the design.
+MOCK_SCRIPT ?= src/main/resources/midasexamples/$(DESIGN).mock
+
+run-mock: $(mock) $(MOCK_SCRIPT)
+	mkdir -p $(OUTPUT_DIR)
+	cd $(GENERATED_DIR) && ./$(notdir $<) $(COMMON_SIM_ARGS) $(ARGS) \
+		+mock-script=$(abspath $(MOCK_SCRIPT)) \
+		+mock-header=$(abspath $(header)) \
+		$(loadmem) \
+		2> $(call logfile,mock)
@@ -63,6 +63,11 @@ class LoadMemLPC
     extends Config((_, _, _) => { case MemModelKey =>
       new LatencyPipeConfig(BaseParams(maxReads = 16, maxWrites = 16, beatCounters = true, llcKey = None))
     })
+// Shrinks host DRAM channels to 16 KiB, spreading the 64 KiB of LoadMemModule over all four F1 channels
+class LoadMemSmallHostChannels
+    extends Config((_, _, up) => { case midas.core.HostMemChannelKey =>
+      up(midas.core.HostMemChannelKey).copy(size = 0x4000)
+    })
 class NoSynthAsserts
     extends Config((_, _, _) => { case SynthAsserts =>
       false
@@ -21,6 +21,13 @@ class PlusArgsModuleTestConfigGroup29Bit
       1
     })
 
+/** Defines a test group with the id of 2
+  */
+class PlusArgsModuleTestConfigGroup255Bit
+    extends Config((_, _, _) => { case PlusArgsTestNumberKey =>
+      2
+    })
+
 case object PlusArgsTestNumberKey extends Field[Int]
 
 class PlusArgsModuleIO(val params: PlusArgsBridgeParams) extends Bundle {
@@ -41,9 +48,19 @@ class PlusArgsDUT(implicit val p: Parameters) extends Module {
     PlusArgsBridgeParams(name = "plusar_v=%d", default = BigInt("4"), width = 29)
   }
 
+  // Spans four 64-bit words, with set bits on both sides of each word boundary
+  def testGroup2(): PlusArgsBridgeParams = {
+    PlusArgsBridgeParams(
+      name    = "plusar_v=%d",
+      default = BigInt("7edcba98765432100123456789abcdeffffffffffffffffe8000000000000001", 16),
+      width   = 255,
+    )
+  }
+
   val params = p(PlusArgsTestNumberKey) match {
     case 0 => testGroup0()
     case 1 => testGroup1()
+    case 2 => testGroup2()
     case _ => throw new RuntimeException("Test Group #{p(PlusArgsTestNumberKey)} does not exist")
   }
 
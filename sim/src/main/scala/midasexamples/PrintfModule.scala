@@ -3,6 +3,7 @@
 package firesim.midasexamples
 
 import chisel3._
+import chisel3.util.Fill
 import chisel3.util.random.LFSR
 import org.chipsalliance.cde.config.Parameters
 
@@ -71,3 +72,50 @@ class NarrowPrintfModuleDUT extends Module {
 
 class NarrowPrintfModule(implicit p: Parameters)
     extends firesim.lib.testutils.PeekPokeHarness(() => new NarrowPrintfModuleDUT)
+
+/** Prints arguments whose widths straddle the 64-bit words used by the driver to format them, checking conversions
+  * across word boundaries against the RTL simulator.
+  */
+class WidePrintfModuleDUT extends Module {
+  val io = IO(new Bundle {
+    val enable = Input(Bool())
+  })
+
+  val cycle = Reg(UInt(16.W))
+  cycle := cycle + 1.U
+
+  // Scramble a 256-bit value every cycle, so that every word of it changes
+  val wide = Reg(UInt(256.W))
+  wide := (wide << 1)(255, 0) ^ Fill(16, LFSR(16, io.enable))
+
+  // Shifting out most bits yields small values and zeros in wide fields
+  val narrowed = (wide >> cycle(7, 0))(254, 0)
+
+  when(io.enable) {
+    SynthesizePrintf(
+      printf(
+        "SYNTHESIZED_PRINT CYCLE: %d 64b: %d 65b: %d 128b: %d 255b: %d\n",
+        cycle,
+        wide(63, 0),
+        wide(64, 0),
+        wide(127, 0),
+        wide(254, 0),
+      )
+    )
+    SynthesizePrintf(
+      printf(
+        "SYNTHESIZED_PRINT CYCLE: %d 64b: %x 65b: %x 128b: %x 255b: %x\n",
+        cycle,
+        wide(63, 0),
+        wide(64, 0),
+        wide(127, 0),
+        wide(254, 0),
+      )
+    )
+    SynthesizePrintf(printf("SYNTHESIZED_PRINT CYCLE: %d 65b: %b 255b: %b\n", cycle, wide(64, 0), wide(254, 0)))
+    SynthesizePrintf(printf("SYNTHESIZED_PRINT CYCLE: %d narrowed: %d %x\n", cycle, narrowed, narrowed))
+  }
+}
+
+class WidePrintfModule(implicit p: Parameters)
+    extends firesim.lib.testutils.PeekPokeHarness(() => new WidePrintfModuleDUT)
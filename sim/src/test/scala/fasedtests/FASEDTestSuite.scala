@@ -2,10 +2,11 @@
 
 package firesim.fasedtests
 
-import java.io.File
+import java.io.{File, PrintWriter}
 
 import scala.io.Source
 import org.scalatest.Suites
+import org.scalatest.matchers.should._
 
 import firesim.TestSuiteUtil._
 import firesim.midasexamples.BaseConfigs
@@ -133,6 +134,44 @@ class AXI4FuzzerLLCDRAMTest      extends FASEDTest("AXI4Fuzzer", "LLCDRAMConfig"
   //}
 }
 
+/** Runs the fuzzer over the points of a +fased-sweep file. The last point repeats the configuration of the first one
+  * and must take as many cycles, since every point starts from the same state.
+  */
+class AXI4FuzzerSweepTest extends FASEDTest("AXI4Fuzzer", "DefaultConfig") with Matchers {
+  val sweepPoints = Seq(
+    "+mm_readLatency_0=30 +mm_writeLatency_0=30",
+    "+mm_readLatency_0=120 +mm_writeLatency_0=120",
+    "+mm_readLatency_0=30 +mm_writeLatency_0=30",
+  )
+
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    val sweepFile = new File(outDir, "fased-sweep.txt")
+    val results   = new File(outDir, s"fased-sweep.${backend}.csv")
+    val writer    = new PrintWriter(sweepFile)
+    writer.println("# One FASED configuration per line")
+    sweepPoints.foreach(point => writer.println(point))
+    writer.close()
+
+    runTest(
+      backend,
+      debug,
+      additionalPlusArgs = Seq(s"+fased-sweep=${sweepFile}", s"+fased-sweep-results=${results}"),
+      behaviorSpec       = Some("run a sweep file"),
+    )
+
+    it should "run each point of the sweep to completion from the same state" in {
+      val row    = """^(\d+),"([^"]*)",(\d+),(\d+).*""".r
+      val points = Source.fromFile(results).getLines.toList.tail.collect { case row(point, config, done, cycles) =>
+        (point.toInt, config, done.toInt, cycles.toLong)
+      }
+      points.map(_._2) should equal(sweepPoints)
+      all(points.map(_._3)) should equal(1)
+      points(1)._4 should be > points(0)._4
+      points(2)._4 should equal(points(0)._4)
+    }
+  }
+}
+
 // Generate a target memory system that uses the whole host memory system.
 class BaselineMultichannelTest
     extends FASEDTest("AXI4Fuzzer", "AddrBits22_QuadFuzzer_DefaultConfig", Seq("AddrBits22_SmallQuadChannelHostConfig"))
@@ -145,6 +184,7 @@ class CIGroupA
     extends Suites(
       new AXI4FuzzerLBPTest,
       new AXI4FuzzerFRFCFSTest,
+      new AXI4FuzzerSweepTest,
     )
 
 class CIGroupB
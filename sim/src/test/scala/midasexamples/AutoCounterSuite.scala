@@ -61,6 +61,26 @@ abstract class AutoCounterSuite(
     }
   }
 
+  /** Types of the counters by label, and samples as maps from labels to values.
+    */
+  type Samples = (Map[String, String], Seq[Map[String, String]])
+
+  def splitAtCommas(s: String): Seq[String] = s.split(",").map(_.trim).toSeq
+
+  /** Parses the samples of an AutoCounter CSV, the cycle of samples being labelled "label".
+    */
+  def readSamples(lines: Seq[String]): Samples = {
+    val labels = splitAtCommas(lines(2))
+    val types  = labels.zip(splitAtCommas(lines(4))).toMap
+    val rows   = lines.drop(AutoCounterVerificationConstants.headerLines).map(l => labels.zip(splitAtCommas(l)).toMap)
+    (types, rows)
+  }
+
+  /** Parses the samples of the in-circuit printf reference.
+    */
+  def readReference(backend: String, stdoutPrefix: String = "AUTOCOUNTER_PRINT "): Samples =
+    readSamples(extractLines(new File(outDir, s"/${targetName}.${backend}.out"), stdoutPrefix, headerLines = 0))
+
   override def defineTests(backend: String, debug: Boolean): Unit = {
     it should "run in the simulator" in {
       assert(run(backend, debug, args = simulationArgs) == 0)
@@ -102,6 +122,104 @@ class MulticlockAutoCounterF1Test
       simulationArgs = Seq("+autocounter-readrate=1000", "+autocounter-filename-base=autocounter"),
     )
 
+/** Decimates the raw samples of AutoCounterModule and aggregates them over windows, checking both outputs against the
+  * in-circuit printf reference.
+  */
+class AutoCounterAggregateF1Test
+    extends AutoCounterSuite(
+      "AutoCounterModule",
+      Seq(),
+      simulationArgs = Seq(
+        "+autocounter-readrate=1000",
+        "+autocounter-filename-base=autocounter",
+        "+autocounter-raw-decimation=4",
+        "+autocounter-aggregate-interval=4",
+      ),
+    ) {
+  val readRate = 1000
+  val interval = 4
+
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "run in the simulator" in {
+      assert(run(backend, debug, args = simulationArgs) == 0)
+    }
+
+    it should "write one in every 4 samples to the raw csv" in {
+      val (_, reference) = readReference(backend)
+      val acFile         = new File(genDir, "/autocounter0.csv")
+      val (_, rows)      = readSamples(extractLines(acFile, prefix = "", headerLines = 0))
+      assert(rows.nonEmpty)
+      rows should equal(reference.grouped(interval).map(_.head).take(rows.size).toSeq)
+    }
+
+    it should "aggregate every 4 samples in the aggregate csv" in {
+      val (types, reference) = readReference(backend)
+      val byCycle            = reference.map(row => row("label").toLong -> row).toMap
+      val aggregateFile      = new File(genDir, "/autocounter0-aggregate.csv")
+      val lines              = extractLines(aggregateFile, prefix = "", headerLines = 3)
+      assert(lines.nonEmpty)
+
+      // Statistics are printed with 6 significant digits.
+      def near(field: String, actual: String, expected: Double): Unit = {
+        val error = math.abs(actual.toDouble - expected)
+        assert(error <= 1e-5 * math.abs(expected), s"${field} is ${actual}, not ${expected}")
+      }
+
+      for (Seq(cycle, label, samples, total, mean, min, max, _*) <- lines.map(splitAtCommas)) {
+        assert(samples.toInt > 0 && samples.toInt <= interval)
+        def valueAt(i: Int): Long = byCycle(cycle.toLong - readRate * i)(label).toLong
+        val window                = (0 until samples.toInt).map(valueAt).reverse
+
+        // Accumulators are summarized by their rate of increase per cycle, identity counters by their values.
+        val values = if (types(label) == "Accumulate") {
+          val previous = byCycle.get(cycle.toLong - readRate * samples.toInt).map(_(label).toLong).getOrElse(0L)
+          assert(total.toLong == window.last - previous, s"total of ${label} at cycle ${cycle}")
+          (previous +: window).sliding(2).map { case Seq(a, b) => (b - a).toDouble / readRate }.toSeq
+        } else {
+          window.map(_.toDouble)
+        }
+        near(s"mean of ${label} at cycle ${cycle}", mean, values.sum / values.size)
+        near(s"min of ${label} at cycle ${cycle}", min, values.min)
+        near(s"max of ${label} at cycle ${cycle}", max, values.max)
+      }
+
+      // Only the last window of each counter can be cut short by the end of the simulation.
+      for ((label, rows) <- lines.map(splitAtCommas).groupBy(_(1))) {
+        assert(rows.init.forall(_(2).toInt == interval), s"short window of ${label}")
+      }
+    }
+  }
+}
+
+/** Only records the samples of AutoCounterModule falling in the detailed phases of a phase file.
+  */
+class AutoCounterPhaseFileF1Test
+    extends AutoCounterSuite(
+      "AutoCounterModule",
+      Seq(),
+      simulationArgs = Seq(
+        "+autocounter-readrate=1000",
+        "+autocounter-filename-base=autocounter",
+        s"+phase-file=${PhaseFileTest.write().getPath}",
+      ),
+    ) {
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "run in the simulator" in {
+      assert(run(backend, debug, args = simulationArgs) == 0)
+    }
+
+    it should "only write samples taken in detailed phases" in {
+      val (_, reference) = readReference(backend)
+      val acFile         = new File(genDir, "/autocounter0.csv")
+      val (_, rows)      = readSamples(extractLines(acFile, prefix = "", headerLines = 0))
+      val expected       = reference.filter(row => PhaseFileTest.detailed(row("label").toLong))
+      assert(expected.size < reference.size)
+      assert(rows.nonEmpty)
+      rows should equal(expected.take(rows.size))
+    }
+  }
+}
+
 class AutoCounterGlobalResetConditionF1Test
     extends TutorialSuite(
       "AutoCounterGlobalResetCondition",
@@ -141,4 +259,6 @@ class AutoCounterCITests
       new MulticlockAutoCounterF1Test,
       new AutoCounterGlobalResetConditionF1Test,
       new AutoCounter32bRolloverTest,
+      new AutoCounterAggregateF1Test,
+      new AutoCounterPhaseFileF1Test,
     )
@@ -2,15 +2,58 @@
 
 package firesim.midasexamples
 
-import java.io.File
+import java.io.{File, PrintWriter}
 import scala.io.Source
 import org.scalatest.Suites
 
 class GCDF1Test extends TutorialSuite("GCD", basePlatformConfig = BaseConfigs.F1)
 
+// Exercise batched peeks and pokes on designs with multiple ports
+class GCDTransactionalF1Test   extends TutorialSuite("GCD", simulationArgs = Seq("+peek-poke-transactional"))
+class StackTransactionalF1Test extends TutorialSuite("Stack", simulationArgs = Seq("+peek-poke-transactional"))
+
 // Hijack Parity to test all of the Midas-level backends
 class ParityF1Test extends TutorialSuite("Parity", basePlatformConfig = BaseConfigs.F1)
 
+/** Replays a stimulus trace loaded from a file through +stimulus-trace. Inputs are held over multiple cycles, so the
+  * harness steps the target over several cycles between events.
+  */
+class ParityStimulusTraceF1Test extends TutorialSuite("Parity") {
+  /** Writes a trace holding io_in for a random number of cycles, expecting the parity after each run of cycles. If
+    * `corrupt` is set, the last expected value is wrong.
+    */
+  def writeTrace(corrupt: Boolean): File = {
+    val gen   = new scala.util.Random(41)
+    val trace = File.createTempFile("parity", ".trace")
+    trace.deleteOnExit()
+    val out = new PrintWriter(trace)
+    out.println("# <cycle> poke|expect <port> <hex value>")
+    var cycle = 0
+    var odd   = 0
+    for (i <- 0 until 32) {
+      val bit    = gen.nextInt(2)
+      val length = 1 + gen.nextInt(16)
+      out.println(s"${cycle} poke io_in 0x${bit}")
+      cycle += length
+      odd = (odd + bit * length) % 2
+      val expected = if (corrupt && i == 31) 1 - odd else odd
+      out.println(s"${cycle} expect io_out ${expected}")
+      out.println()
+    }
+    out.close()
+    trace
+  }
+
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "pass a stimulus trace loaded from a file" in {
+      assert(run(backend, debug, args = Seq(s"+stimulus-trace=${writeTrace(corrupt = false).getPath}")) == 0)
+    }
+    it should "fail a stimulus trace with a wrong expected value" in {
+      assert(run(backend, debug, args = Seq(s"+stimulus-trace=${writeTrace(corrupt = true).getPath}")) != 0)
+    }
+  }
+}
+
 class CustomConstraintsF1Test extends TutorialSuite("CustomConstraints") {
 
   override def defineTests(backend: String, debug: Boolean): Unit = {
@@ -55,12 +98,16 @@ class VerilogAccumulatorF1Test  extends TutorialSuite("VerilogAccumulator")
 class ChiselExampleDesigns
     extends Suites(
       new GCDF1Test,
+      new GCDTransactionalF1Test,
       new ParityF1Test,
+      new ParityStimulusTraceF1Test,
       new PlusArgsGroup68Bit,
       new PlusArgsGroup29Bit,
+      new PlusArgsGroup255Bit,
       new ResetShiftRegisterF1Test,
       new EnableShiftRegisterF1Test,
       new StackF1Test,
+      new StackTransactionalF1Test,
       new RiscF1Test,
       new RiscSRAMF1Test,
       new AccumulatorF1Test,
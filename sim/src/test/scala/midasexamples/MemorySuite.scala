@@ -3,6 +3,8 @@
 package firesim.midasexamples
 
 import java.io._
+import java.nio.{ByteBuffer, ByteOrder}
+import java.nio.file.Files
 
 import org.scalatest.Suites
 import org.scalatest.matchers.should._
@@ -12,7 +14,9 @@ import firesim.BasePlatformConfig
 abstract class LoadMemTest(
   override val basePlatformConfig: BasePlatformConfig,
   val extraArgs:                   Seq[String] = Seq(),
-) extends TutorialSuite("LoadMemModule", platformConfigs = Seq("NoSynthAsserts", "LoadMemLPC"))
+  val numLines:                    Int         = 128,
+  extraPlatformConfigs:            Seq[String] = Seq(),
+) extends TutorialSuite("LoadMemModule", platformConfigs = extraPlatformConfigs ++ Seq("NoSynthAsserts", "LoadMemLPC"))
     with Matchers {
 
   /** Helper to generate tests strings.
@@ -27,6 +31,35 @@ abstract class LoadMemTest(
       .mkString("\n")
   }
 
+  /** Writes the test data to the file passed through +loadmem, as a hex file by default.
+    */
+  def writeInput(data: String): File = {
+    val input       = File.createTempFile("input", ".txt")
+    input.deleteOnExit()
+    val inputWriter = new BufferedWriter(new FileWriter(input))
+    inputWriter.write(data)
+    inputWriter.flush()
+    inputWriter.close()
+    input
+  }
+
+  /** Runs the design with the given arguments, returning the words it read from memory.
+    */
+  def readMem(backend: String, debug: Boolean, args: Seq[String]): String = {
+    // Create an output file.
+    val output = File.createTempFile("output", ".txt")
+    output.deleteOnExit()
+
+    assert(
+      run(
+        backend,
+        debug,
+        args = Seq(s"+n=${numLines}", s"+test-dump-file=${output.getPath}") ++ args ++ extraArgs,
+      ) == 0
+    )
+    scala.io.Source.fromFile(output.getPath).mkString
+  }
+
   /** Runs MIDAS-level simulation on the design.
     *
     * @param backend
@@ -37,30 +70,13 @@ abstract class LoadMemTest(
   override def defineTests(backend: String, debug: Boolean): Unit = {
     it should "read data provided by LoadMem" in {
       // Generate a random string spanning 2 sectors with a fixed seed.
-      val numLines = 128
-      val data     = getTestInput(numLines)
+      val data = getTestInput(numLines)
 
       // Create an input file.
-      val input       = File.createTempFile("input", ".txt")
-      input.deleteOnExit()
-      val inputWriter = new BufferedWriter(new FileWriter(input))
-      inputWriter.write(data)
-      inputWriter.flush()
-      inputWriter.close()
-
-      // Create an output file.
-      val output = File.createTempFile("output", ".txt")
+      val input = writeInput(data)
 
       // Run the test and compare the two files.
-      assert(
-        run(
-          backend,
-          debug,
-          args = Seq(s"+n=${numLines} +loadmem=${input.getPath}", s"+test-dump-file=${output.getPath}") ++ extraArgs,
-        ) == 0
-      )
-      val result = scala.io.Source.fromFile(output.getPath).mkString
-      result should equal(data + "\n")
+      readMem(backend, debug, Seq(s"+loadmem=${input.getPath}")) should equal(data + "\n")
     }
   }
 }
@@ -69,8 +85,116 @@ class LoadMemF1Test extends LoadMemTest(BaseConfigs.F1)
 
 class FastLoadMemF1Test extends LoadMemTest(BaseConfigs.F1, extraArgs = Seq("+fastloadmem"))
 
+class TimedHostMemLoadMemF1Test
+    extends LoadMemTest(
+      BaseConfigs.F1,
+      extraArgs = Seq("+host-mem-model=timed", "+host-mem-read-latency=40", "+host-mem-banks=2"),
+    )
+
+/** Loads the test data from an ELF file holding a single PT_LOAD segment, placed at the base of DRAM.
+  */
+class ElfLoadMemF1Test extends LoadMemTest(BaseConfigs.F1, extraArgs = Seq("+loadmem-elf-base=10000000")) {
+  val dramBase = 0x10000000L
+
+  override def writeInput(data: String): File = {
+    val words  = data.split("\n").map(java.lang.Long.parseUnsignedLong(_, 16))
+    val ehsize = 64
+    val phsize = 56
+    val buffer = ByteBuffer.allocate(ehsize + phsize + 8 * words.length).order(ByteOrder.LITTLE_ENDIAN)
+
+    // ELF header of a little-endian, 64-bit RISC-V executable, without section headers.
+    buffer.put(Array[Byte](0x7f, 'E'.toByte, 'L'.toByte, 'F'.toByte, 2, 1, 1) ++ Array.fill[Byte](9)(0))
+    buffer.putShort(2).putShort(0xf3.toShort).putInt(1)
+    buffer.putLong(dramBase).putLong(ehsize).putLong(0).putInt(0)
+    buffer.putShort(ehsize.toShort).putShort(phsize.toShort).putShort(1)
+    buffer.putShort(64).putShort(0).putShort(0)
+
+    // Program header of a single PT_LOAD segment holding the data, followed by the data.
+    val size = 8L * words.length
+    buffer.putInt(1).putInt(6).putLong(ehsize + phsize)
+    buffer.putLong(dramBase).putLong(dramBase).putLong(size).putLong(size).putLong(8)
+    words.foreach(word => buffer.putLong(word))
+
+    val input = File.createTempFile("input", ".elf")
+    input.deleteOnExit()
+    Files.write(input.toPath, buffer.array)
+    input
+  }
+}
+
+/** Loads a hex image twice with +loadmem-cache: the first run decodes the image and caches it, the second one loads the
+  * cached copy.
+  */
+class CachedLoadMemF1Test extends LoadMemTest(BaseConfigs.F1, extraArgs = Seq("+fastloadmem", "+loadmem-cache")) {
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "read data provided by LoadMem through the image cache" in {
+      val data  = getTestInput(numLines)
+      val input = writeInput(data)
+      val cache = new File(input.getPath + ".bin")
+      cache.deleteOnExit()
+
+      readMem(backend, debug, Seq(s"+loadmem=${input.getPath}")) should equal(data + "\n")
+      cache should exist
+      readMem(backend, debug, Seq(s"+loadmem=${input.getPath}")) should equal(data + "\n")
+    }
+  }
+}
+
+/** Loads an image spanning the first two host DRAM channels, which are shrunk to 16 KiB each.
+  */
+class MultiChannelLoadMemF1Test
+    extends LoadMemTest(
+      BaseConfigs.F1,
+      extraArgs            = Seq("+fastloadmem"),
+      numLines             = 2560,
+      extraPlatformConfigs = Seq("LoadMemSmallHostChannels"),
+    )
+
+/** Saves the contents of DRAM with +dram-snapshot after loading the test data, then loads the snapshot in a second run.
+  */
+class DRAMSnapshotLoadMemF1Test extends LoadMemTest(BaseConfigs.F1) {
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "read data restored from a DRAM snapshot" in {
+      val data     = getTestInput(numLines)
+      val input    = writeInput(data)
+      val snapshot = File.createTempFile("dram", ".snapshot")
+      snapshot.deleteOnExit()
+
+      val snapshotArgs = Seq(s"+dram-snapshot=${snapshot.getPath}", s"+dram-snapshot-size=${8 * numLines}")
+      readMem(backend, debug, Seq(s"+loadmem=${input.getPath}") ++ snapshotArgs) should equal(data + "\n")
+      readMem(backend, debug, Seq(s"+loadmem=${snapshot.getPath}")) should equal(data + "\n")
+    }
+  }
+}
+
+/** Saves the host DRAM models with +host-mem-snapshot after loading the test data, then restores them in a second run
+  * which does not load any image.
+  */
+class HostMemSnapshotLoadMemF1Test extends LoadMemTest(BaseConfigs.F1) {
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "read data restored from a host memory snapshot" in {
+      val data   = getTestInput(numLines)
+      val input  = writeInput(data)
+      val prefix = File.createTempFile("host-mem", "")
+      prefix.deleteOnExit()
+      // F1 metasimulations model four channels, each saved to <prefix>.<channel>.
+      (0 until 4).foreach(i => new File(s"${prefix.getPath}.${i}").deleteOnExit())
+
+      val snapshotArgs = Seq("+fastloadmem", s"+loadmem=${input.getPath}", s"+host-mem-snapshot=${prefix.getPath}")
+      readMem(backend, debug, snapshotArgs) should equal(data + "\n")
+      readMem(backend, debug, Seq(s"+host-mem-restore=${prefix.getPath}")) should equal(data + "\n")
+    }
+  }
+}
+
 class MemoryCITests
     extends Suites(
       new LoadMemF1Test,
       new FastLoadMemF1Test,
+      new TimedHostMemLoadMemF1Test,
+      new ElfLoadMemF1Test,
+      new CachedLoadMemF1Test,
+      new MultiChannelLoadMemF1Test,
+      new DRAMSnapshotLoadMemF1Test,
+      new HostMemSnapshotLoadMemF1Test,
     )
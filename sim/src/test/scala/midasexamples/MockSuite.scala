@@ -0,0 +1,21 @@
+//See LICENSE for license details.
+
+package firesim.midasexamples
+
+import java.io.File
+import scala.io.Source
+
+/** Runs the driver of a design against the in-memory mock platform instead of a metasimulator, using the example
+  * script checked in for the design.
+  */
+class PassthroughModelMockF1Test extends TutorialSuite("PassthroughModel") {
+  override def simulators: Seq[String] = Seq("mock")
+
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "run against the mock platform" in {
+      assert(make("run-mock", "LOGFILE=", "ARGS=") == 0)
+      val log = Source.fromFile(new File(outDir, s"${targetName}.mock.out")).getLines().toList
+      log should contain("*** PASSED *** after 65541 cycles")
+    }
+  }
+}
@@ -45,3 +45,25 @@ class PlusArgsGroup29Bit
     }
   }
 }
+
+class PlusArgsGroup255Bit
+    extends TutorialSuite("PlusArgsModule", "PlusArgsModuleTestConfigGroup255Bit")
+    with PlusArgsKey {
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "provide the correct default value, 8 slices" in {
+      assert(run(backend, debug, args = Seq(getKey(2, 0))) == 0)
+    }
+
+    it should "accept values across word boundaries" in {
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${BigInt(1) << 64}", getKey(2, 1))) == 0)
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${(BigInt(1) << 128) - 1}", getKey(2, 2))) == 0)
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${BigInt(1) << 192}", getKey(2, 3))) == 0)
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${(BigInt(1) << 255) - 1}", getKey(2, 4))) == 0)
+    }
+
+    it should "reject large runtime values" in {
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${BigInt(1) << 255}", getKey(2, 5))) != 0)
+      assert(run(backend, debug, args = Seq(s"+plusar_v=${BigInt(1) << 256}", getKey(2, 6))) != 0)
+    }
+  }
+}
@@ -2,7 +2,7 @@
 
 package firesim.midasexamples
 
-import java.io.File
+import java.io.{File, PrintWriter}
 import org.scalatest.Suites
 
 import firesim.TestSuiteUtil._
@@ -89,6 +89,19 @@ abstract class NarrowPrintfModuleTest(val platform: BasePlatformConfig)
 
 class NarrowPrintfModuleF1Test extends NarrowPrintfModuleTest(BaseConfigs.F1)
 
+abstract class WidePrintfModuleTest(val platform: BasePlatformConfig)
+    extends PrintfSuite(
+      "WidePrintfModule",
+      simulationArgs     = Seq("+print-no-cycle-prefix", "+print-file=synthprinttest.out"),
+      basePlatformConfig = platform,
+    ) {
+  override def addChecks(backend: String): Unit = {
+    diffSynthesizedLog(backend, "synthprinttest.out0")
+  }
+}
+
+class WidePrintfModuleF1Test extends WidePrintfModuleTest(BaseConfigs.F1)
+
 abstract class MulticlockPrintfModuleTest(val platform: BasePlatformConfig)
     extends PrintfSuite(
       "MulticlockPrintfModule",
@@ -145,6 +158,65 @@ class PrintfCycleBoundsTestBase(startCycle: Int, endCycle: Int)
 
 class PrintfCycleBoundsF1Test extends PrintfCycleBoundsTestBase(startCycle = 172, endCycle = 9377)
 
+/** Records the traffic of a simulation with +trace-record, then replays it without the RTL simulator and checks that
+  * the replayed driver prints the same output.
+  */
+class PrintfModuleTraceReplayF1Test
+    extends PrintfSuite("PrintfModule", simulationArgs = Seq("+print-no-cycle-prefix")) {
+  override def addChecks(backend: String): Unit = {}
+
+  override def defineTests(backend: String, debug: Boolean): Unit = {
+    it should "replay a recorded host trace" in {
+      val trace      = new File(genDir, "printf.trace")
+      val recordArgs = Seq("+print-file=recorded.out", s"+trace-record=${trace.getPath}")
+      val replayArgs = Seq("+print-file=replayed.out", s"+trace-replay=${trace.getPath}")
+      assert(run(backend, debug, args = simulationArgs ++ recordArgs) == 0)
+      assert(run(backend, debug, args = simulationArgs ++ replayArgs) == 0)
+      val recorded = extractLines(new File(genDir, "recorded.out0"), prefix = "")
+      val replayed = extractLines(new File(genDir, "replayed.out0"), prefix = "")
+      diffLines(replayed, recorded, aName = "Replayed output", bName = "Recorded output")
+    }
+  }
+}
+
+/** Detailed phases of the phase-file tests, in base clock cycles. Samples taken every 1000 cycles fall in both the
+  * first and the last phase, but not between them.
+  */
+object PhaseFileTest {
+  val windows = Seq((1000L, 1500L), (2900L, 3100L))
+
+  def detailed(cycle: Long): Boolean = windows.exists { case (start, end) => start <= cycle && cycle < end }
+
+  def write(): File = {
+    val file   = File.createTempFile("phases", ".txt")
+    file.deleteOnExit()
+    val writer = new PrintWriter(file)
+    writer.println("# Detailed phases, as <start>:<end>")
+    windows.foreach { case (start, end) => writer.println(s"${start}:${end}") }
+    writer.close()
+    file
+  }
+}
+
+/** Only prints during the detailed phases of a phase file.
+  */
+class PrintfPhaseFileF1Test
+    extends PrintfSuite(
+      "PrintfModule",
+      simulationArgs = Seq("+print-file=synthprinttest.out", s"+phase-file=${PhaseFileTest.write().getPath}"),
+    ) {
+  override def addChecks(backend: String): Unit = {
+    val synthLogFile = new File(genDir, "/synthprinttest.out0")
+    val printRegex   = raw"^CYCLE:\s*(\d*) SYNTHESIZED_PRINT CYCLE:\s*(\d*).*".r
+    val cycles       = extractLines(synthLogFile, prefix = "").map { case printRegex(cycleA, cycleB) =>
+      assert(cycleA == cycleB)
+      cycleA.toLong
+    }
+    val expected     = PhaseFileTest.windows.flatMap { case (start, end) => (start until end).flatMap(Seq.fill(4)(_)) }
+    assert(cycles == expected)
+  }
+}
+
 class PrintfGlobalResetConditionTest
     extends TutorialSuite(
       "PrintfGlobalResetCondition",
@@ -173,8 +245,11 @@ class PrintfSynthesisCITests
     extends Suites(
       new PrintfModuleF1Test,
       new NarrowPrintfModuleF1Test,
+      new WidePrintfModuleF1Test,
       new MulticlockPrintF1Test,
       new PrintfCycleBoundsF1Test,
+      new PrintfModuleTraceReplayF1Test,
+      new PrintfPhaseFileF1Test,
       new TriggerPredicatedPrintfF1Test,
       new PrintfGlobalResetConditionTest,
       new AutoCounterPrintfF1Test,
@@ -55,4 +55,5 @@ class CIGroupB
       new firesim.FailingUnitTests,
       new FMRCITests,
       new PointerChaserTests,
+      new PassthroughModelMockF1Test,
     )